@@ -0,0 +1,44 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../include/dqn.h"
+#include "benchmark.h"
+
+/*
+    Benchmark: action_benchmark
+
+    Description: Measures the latency of greedy action selection with the 10 -> 128 -> 128 -> 4
+        policy network. Compares DQN::selectActionTest, which evaluates the live network through
+        the const, allocation-free inference path, against the previous selection, which took the
+        network by value and so deep copied every layer on every call before running forward.
+*/
+
+// The previous action selection, with the network passed by value.
+int previousSelectAction(const std::vector<float>& state, NeuralNetwork policy_net) {
+    std::vector<float> q_values = policy_net.forward(state);
+    return std::distance(q_values.begin(), std::max_element(q_values.begin(), q_values.end()));
+}
+
+int main() {
+    NetworkParams params;
+    params.RANDOM_SEED = 42;
+    DQN dqn(10, 4, 1000, params);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dis(0.0, 1.0);
+    std::vector<float> state(10);
+    for (float& value : state) {
+        value = dis(gen);
+    }
+
+    int sink = 0;
+    double previous = nanosecondsPerCall([&]() { sink += previousSelectAction(state, dqn.policy_net); });
+    double current = nanosecondsPerCall([&]() { sink += dqn.selectActionTest(state.data()); });
+
+    std::cout << "previous (copy + forward): " << previous << " ns/action" << std::endl;
+    std::cout << "selectActionTest (infer):  " << current << " ns/action" << std::endl;
+    std::cout << "speedup: " << previous / current << "x (checksum " << sink << ")" << std::endl;
+    return 0;
+}
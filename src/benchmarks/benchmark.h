@@ -0,0 +1,80 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+// Timing harness shared by the benchmarks. A function is run until it is warm and the number of
+// calls in one repetition is calibrated so that a repetition lasts at least min_time_ms, long
+// enough for the clock's resolution not to matter. The repetitions are then timed separately,
+// so that the result is a distribution of the time per call rather than a single average.
+
+const int BENCHMARK_REPETITIONS = 15;
+const double BENCHMARK_MIN_TIME_MS = 20;
+
+struct BenchmarkResult {
+    long iterations;             // Calls per repetition.
+    std::vector<double> samples; // Nanoseconds per call, one per repetition.
+    double mean, median, stddev, min, max;
+};
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Function>
+double timeCalls(long iterations, Function& function) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        function();
+    } return secondsSince(start);
+}
+
+// Warms the function up while doubling the calls per repetition, or jumping straight to an
+// estimate once a run is long enough to time, until a repetition lasts at least min_time_ms.
+template <typename Function>
+long calibrateIterations(Function& function, double min_time_ms) {
+    double min_time = min_time_ms / 1000;
+    long iterations = 1;
+    while (true) {
+        double elapsed = timeCalls(iterations, function);
+        if (elapsed >= min_time) return iterations;
+        iterations = elapsed > 0 ? std::max(iterations * 2, (long)(iterations * 1.2 * min_time / elapsed)) : iterations * 10;
+    }
+}
+
+inline void summarise(BenchmarkResult& result) {
+    std::vector<double> sorted = result.samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t count = sorted.size();
+    result.min = sorted.front();
+    result.max = sorted.back();
+    result.median = count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+    result.mean = 0;
+    for (double sample : sorted) result.mean += sample;
+    result.mean /= count;
+    result.stddev = 0;
+    for (double sample : sorted) result.stddev += (sample - result.mean) * (sample - result.mean);
+    result.stddev = count > 1 ? std::sqrt(result.stddev / (count - 1)) : 0;
+}
+
+template <typename Function>
+BenchmarkResult measure(Function function, int repetitions = BENCHMARK_REPETITIONS, double min_time_ms = BENCHMARK_MIN_TIME_MS) {
+    BenchmarkResult result;
+    result.iterations = calibrateIterations(function, min_time_ms);
+    for (int r = 0; r < std::max(repetitions, 1); r++) {
+        result.samples.push_back(timeCalls(result.iterations, function) * 1e9 / result.iterations);
+    }
+    summarise(result);
+    return result;
+}
+
+// The median time per call, for the benchmarks which print one number per measurement.
+template <typename Function>
+double nanosecondsPerCall(Function function) {
+    return measure(function).median;
+}
+
+#endif
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/dqn.h"
+#include "../include/environment.h"
+#include "../include/game.h"
+#include "../include/logger.h"
+#include "../include/neural_network.h"
+#include "../include/reward.h"
+#include "../include/rng.h"
+#include "../include/simd_kernels.h"
+#include "benchmark.h"
+
+/*
+    Benchmark: benchmark_suite
+
+    Description: Times the hot paths of training in one run, each on its own with warmup and
+        repeated measurement: the layers and network at batch 1 and 128, DQN::train, the replay
+        memory, state encoding, rewards, the game step and whole environment steps. Prints a
+        table and writes the results as JSON, to compare across commits for regressions.
+
+    Usage:
+        benchmark_suite [--json file] [--filter text] [--repetitions n] [--min-time ms] [--label text]
+
+        --json         Where to write the results, benchmark_results.json by default.
+        --filter       Only run the benchmarks whose name contains the text.
+        --repetitions  Timed repetitions per benchmark, 15 by default.
+        --min-time     Minimum length of one repetition in milliseconds, 20 by default. The
+                       iterations per repetition are calibrated during warmup to reach it.
+        --label        Recorded in the JSON, e.g. the commit being measured.
+*/
+
+struct BenchmarkOptions {
+    std::string json_filepath = "benchmark_results.json";
+    std::string filter;
+    std::string label;
+    int repetitions = BENCHMARK_REPETITIONS;
+    double min_time_ms = BENCHMARK_MIN_TIME_MS;
+};
+
+// One benchmark. run performs one operation which handles items items, e.g. the games of one
+// environment step, so that the throughput is reported per item.
+struct Benchmark {
+    std::string name;
+    double items;
+    std::function<void()> run;
+};
+
+// The timings of one benchmark, see benchmark.h.
+struct SuiteResult {
+    std::string name;
+    double items;
+    BenchmarkResult timing;
+};
+
+// Written by the benchmarks so that the compiler cannot drop the work being timed.
+volatile float benchmark_sink;
+
+void printResult(const SuiteResult& result) {
+    const BenchmarkResult& timing = result.timing;
+    std::cout << std::left << std::setw(36) << result.name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << timing.median << std::setw(14) << timing.mean
+              << std::setw(9) << (timing.mean > 0 ? 100 * timing.stddev / timing.mean : 0) << "%"
+              << std::setw(14) << timing.min << std::setw(16) << std::setprecision(0) << result.items * 1e9 / timing.median
+              << std::endl;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    } return escaped;
+}
+
+void writeJson(const std::vector<SuiteResult>& results, const BenchmarkOptions& options) {
+    std::ofstream file(options.json_filepath);
+    if (!file) {
+        throw std::runtime_error("Could not open benchmark results for writing: " + options.json_filepath);
+    }
+
+    std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    file << std::setprecision(9);
+    file << "{\n";
+    file << "  \"label\": \"" << jsonEscape(options.label) << "\",\n";
+    file << "  \"timestamp\": \"" << timestamp << "\",\n";
+    file << "  \"compiler\": \"" << jsonEscape(__VERSION__) << "\",\n";
+    file << "  \"simd\": \"" << simdKernels().name << "\",\n";
+    file << "  \"repetitions\": " << options.repetitions << ",\n";
+    file << "  \"min_time_ms\": " << options.min_time_ms << ",\n";
+    file << "  \"benchmarks\": [";
+    for (size_t b = 0; b < results.size(); b++) {
+        const BenchmarkResult& timing = results[b].timing;
+        file << (b == 0 ? "\n" : ",\n");
+        file << "    {\"name\": \"" << jsonEscape(results[b].name) << "\", \"iterations\": " << timing.iterations
+             << ", \"items_per_op\": " << results[b].items
+             << ", \"median_ns\": " << timing.median << ", \"mean_ns\": " << timing.mean << ", \"stddev_ns\": " << timing.stddev
+             << ", \"min_ns\": " << timing.min << ", \"max_ns\": " << timing.max
+             << ", \"items_per_second\": " << results[b].items * 1e9 / timing.median << ", \"samples_ns\": [";
+        for (size_t s = 0; s < timing.samples.size(); s++) {
+            file << (s == 0 ? "" : ", ") << timing.samples[s];
+        } file << "]}";
+    }
+    file << "\n  ]\n}\n";
+}
+
+std::vector<float> randomVector(Rng& rng, size_t size) {
+    std::vector<float> values(size);
+    for (float& value : values) {
+        value = rng.uniform();
+    } return values;
+}
+
+// Fills a replay memory with random experiences.
+void fillMemory(ReplayMemory& memory, Rng& rng, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        std::vector<float> state = randomVector(rng, STATE_SIZE);
+        std::vector<float> next_state = randomVector(rng, STATE_SIZE);
+        memory.storeExperience(state.data(), rng.below(ACTION_SIZE), rng.uniform(-1.0f, 1.0f), next_state.data(), i % 50 == 0);
+    }
+}
+
+bool parseOptions(int argc, char** argv, BenchmarkOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (i + 1 >= argc) return false;
+        std::string value = argv[++i];
+        if (argument == "--json") options.json_filepath = value;
+        else if (argument == "--filter") options.filter = value;
+        else if (argument == "--label") options.label = value;
+        else if (argument == "--repetitions") options.repetitions = std::max(1, std::stoi(value));
+        else if (argument == "--min-time") options.min_time_ms = std::stod(value);
+        else return false;
+    } return true;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: benchmark_suite [--json file] [--filter text] [--repetitions n] [--min-time ms] [--label text]" << std::endl;
+        return 1;
+    }
+    logger().level = LOG_LEVEL_WARN; // Keeps the DQN's action summaries out of the table.
+
+    GameParams game_params;
+    game_params.random_seed = 42;
+    NetworkParams network_params;
+    network_params.RANDOM_SEED = 42;
+    const int batch_size = network_params.BATCH_SIZE;
+    Rng rng(42);
+
+    // Layers and networks, the 10 -> 128 -> 128 -> 4 policy network.
+    NeuralNetwork network(network_params.LEARNING_RATE);
+    network.add_layer(STATE_SIZE, 128, rng);
+    network.add_layer(128, 128, rng);
+    network.add_layer(128, ACTION_SIZE, rng);
+    NeuralNetwork::Workspace workspace(network, batch_size);
+    Layer& hidden = network.layers[1];
+
+    std::vector<float> hidden_input = randomVector(rng, 128);
+    std::vector<float> hidden_grad = randomVector(rng, 128);
+    std::vector<float> hidden_batch_input = randomVector(rng, 128 * batch_size);
+    std::vector<float> hidden_batch_grad = randomVector(rng, 128 * batch_size);
+    std::vector<float> state = randomVector(rng, STATE_SIZE);
+    std::vector<float> states = randomVector(rng, STATE_SIZE * batch_size);
+
+    // The agent, with enough experiences stored that train takes a full step.
+    DQN dqn(STATE_SIZE, ACTION_SIZE, network_params.MEMORY_CAPACITY, network_params);
+    fillMemory(dqn.replay_memory, rng, network_params.SAMPLING_THRESHOLD);
+
+    ReplayMemory memory(network_params.MEMORY_CAPACITY, STATE_SIZE, 42, false, network_params.PRIORITY_ALPHA, network_params.PRIORITY_EPSILON);
+    fillMemory(memory, rng, network_params.MEMORY_CAPACITY);
+    ReplayMemory prioritized_memory(network_params.MEMORY_CAPACITY, STATE_SIZE, 42, true, network_params.PRIORITY_ALPHA, network_params.PRIORITY_EPSILON);
+    fillMemory(prioritized_memory, rng, network_params.MEMORY_CAPACITY);
+    ReplayMemory::Batch batch;
+    std::vector<float> next_state = randomVector(rng, STATE_SIZE);
+
+    // The game, stepped with random actions and restarted when it ends.
+    Game game(true, 0, game_params, 0);
+    StateEncoder encoder(game_params);
+    RewardEngine reward_engine(network_params, game_params);
+    std::vector<float> encoded(STATE_SIZE);
+    auto stepGame = [&]() {
+        applyAction(game, rng.below(ACTION_SIZE));
+        game.snake.update();
+        game.checkCollisions();
+        game.game_running = true; // A collision resets the snake and ends the game.
+    };
+
+    VectorEnvironment environment(1, game_params, network_params);
+    VectorEnvironment environments(16, game_params, network_params);
+    std::vector<int> actions(1), batch_actions(16);
+    auto stepEnvironment = [&](VectorEnvironment& env, std::vector<int>& env_actions) {
+        for (int& action : env_actions) action = rng.below(ACTION_SIZE);
+        env.step(env_actions);
+        benchmark_sink = env.rewards[0];
+    };
+
+    std::vector<Benchmark> benchmarks = {
+        {"layer/forward_128x128", 1, [&]() { benchmark_sink = hidden.forward(hidden_input)[0]; }},
+        {"layer/backward_128x128", 1, [&]() { hidden.forward(hidden_input); benchmark_sink = hidden.backward(hidden_grad)[0]; }},
+        {"layer/forward_batch_128x128_b128", (double)batch_size, [&]() { benchmark_sink = hidden.forward_batch(hidden_batch_input, batch_size)[0]; }},
+        {"layer/backward_batch_128x128_b128", (double)batch_size, [&]() {
+            hidden.forward_batch(hidden_batch_input, batch_size);
+            benchmark_sink = hidden.backward_batch(hidden_batch_grad, batch_size)[0];
+        }},
+        {"network/forward_b1", 1, [&]() { benchmark_sink = network.forward(state)[0]; }},
+        {"network/infer_b1", 1, [&]() { benchmark_sink = network.infer(state.data(), workspace)[0]; }},
+        {"network/forward_batch_b128", (double)batch_size, [&]() { benchmark_sink = network.forward_batch(states, batch_size)[0]; }},
+        {"network/infer_batch_b128", (double)batch_size, [&]() { benchmark_sink = network.infer_batch(states.data(), batch_size, workspace)[0]; }},
+        {"dqn/train_b128", (double)batch_size, [&]() { dqn.train(batch_size); }},
+        {"dqn/select_action_train", 1, [&]() { benchmark_sink = dqn.selectActionTrain(state.data(), network_params.MINIMUM_EXPLORATION_THRESHOLD); }},
+        {"replay/store_experience", 1, [&]() { memory.storeExperience(state.data(), 1, 0.5f, next_state.data(), false); }},
+        {"replay/sample_b128", (double)batch_size, [&]() { memory.sample(batch_size, batch); benchmark_sink = batch.rewards[0]; }},
+        {"replay/sample_prioritized_b128", (double)batch_size, [&]() { prioritized_memory.sample(batch_size, batch); benchmark_sink = batch.rewards[0]; }},
+        {"state/get_state", 1, [&]() { benchmark_sink = getState(game.snake, game.food)[0]; }},
+        {"state/encode", 1, [&]() { encoder.encode(game.snake, game.food, encoded.data()); benchmark_sink = encoded[0]; }},
+        {"reward/reward", 1, [&]() { benchmark_sink = reward_engine.reward(game.snake, game.food, game.snake.head()); }},
+        {"game/update_check_collisions", 1, stepGame},
+        {"environment/step_x1", 1, [&]() { stepEnvironment(environment, actions); }},
+        {"environment/step_x16", 16, [&]() { stepEnvironment(environments, batch_actions); }},
+    };
+
+    std::cout << "simd: " << simdKernels().name << " ::: repetitions: " << options.repetitions
+              << " ::: min time: " << options.min_time_ms << " ms" << std::endl;
+    std::cout << std::left << std::setw(36) << "benchmark" << std::right << std::setw(14) << "median ns"
+              << std::setw(14) << "mean ns" << std::setw(10) << "cv" << std::setw(14) << "min ns" << std::setw(16) << "items/sec" << std::endl;
+
+    std::vector<SuiteResult> results;
+    for (const Benchmark& benchmark : benchmarks) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) continue;
+        results.push_back({benchmark.name, benchmark.items, measure(benchmark.run, options.repetitions, options.min_time_ms)});
+        printResult(results.back());
+    }
+
+    writeJson(results, options);
+    std::cout << "results written to " << options.json_filepath << std::endl;
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "../include/checkpoint.h"
+#include "../include/file_reader.h"
+#include "../include/neural_network.h"
+#include "benchmark.h"
+
+/*
+    Benchmark: checkpoint_benchmark
+
+    Description: Measures the time to load the 10-128-128-4 policy network from the previous text
+        files, parsed by read_in_weights and read_in_biases, against mapping a binary checkpoint
+        and against copying a checkpoint into a network. Also counts the parameters which do not
+        round trip exactly through each format.
+*/
+
+// The text format parsed by read_in_weights and read_in_biases, as in best_weights_two.txt.
+void saveText(const NeuralNetwork& network, const std::string& weights_filepath, const std::string& biases_filepath) {
+    std::ofstream weights_file(weights_filepath);
+    std::ofstream biases_file(biases_filepath);
+    for (auto& layer : network.layers) {
+        weights_file << "layer" << std::endl;
+        for (int i = 0; i < layer.output_size; i++) {
+            weights_file << "row ";
+            for (int j = 0; j < layer.input_size; j++) {
+                weights_file << layer.row(i)[j] << " ";
+            } weights_file << std::endl;
+        }
+
+        biases_file << "bias" << std::endl;
+        for (auto& bias : layer.biases) {
+            biases_file << bias << " ";
+        } biases_file << std::endl;
+    }
+}
+
+NeuralNetwork makeNetwork() {
+    NeuralNetwork network(0.0001f);
+    network.add_layer(10, 128);
+    network.add_layer(128, 128);
+    network.add_layer(128, 4);
+    return network;
+}
+
+int mismatches(const NeuralNetwork& a, const NeuralNetwork& b) {
+    int count = 0;
+    for (size_t l = 0; l < a.layers.size(); l++) {
+        for (int i = 0; i < a.layers[l].output_size; i++) {
+            for (int j = 0; j < a.layers[l].input_size; j++) {
+                count += a.layers[l].row(i)[j] != b.layers[l].row(i)[j];
+            }
+            count += a.layers[l].biases[i] != b.layers[l].biases[i];
+        }
+    } return count;
+}
+
+template <typename Function>
+double microseconds(Function function) {
+    return nanosecondsPerCall(function) / 1000;
+}
+
+int main() {
+    NeuralNetwork network = makeNetwork();
+    saveText(network, "benchmark_weights.txt", "benchmark_biases.txt");
+    saveCheckpoint("benchmark_checkpoint.bin", network);
+
+    NeuralNetwork text_network = makeNetwork();
+    double text_time = microseconds([&]() {
+        std::vector<std::vector<std::vector<float>>> weights = read_in_weights("benchmark_weights.txt");
+        std::vector<std::vector<float>> biases = read_in_biases("benchmark_biases.txt");
+        text_network.load_in_network_params(weights, biases);
+    });
+
+    int mapped_mismatches = 0;
+    double mapped_time = microseconds([&]() {
+        MappedCheckpoint checkpoint("benchmark_checkpoint.bin");
+        mapped_mismatches = mismatches(network, checkpoint.network);
+    });
+
+    NeuralNetwork loaded_network = makeNetwork();
+    double load_time = microseconds([&]() {
+        loadCheckpoint("benchmark_checkpoint.bin", loaded_network);
+    });
+
+    std::cout << "text: " << text_time << " us ::: " << mismatches(network, text_network) << " inexact parameters" << std::endl;
+    std::cout << "mapped checkpoint: " << mapped_time << " us ::: " << mapped_mismatches << " inexact parameters" << std::endl;
+    std::cout << "loaded checkpoint: " << load_time << " us ::: " << mismatches(network, loaded_network) << " inexact parameters" << std::endl;
+    std::cout << "speedup of mapping over text: " << text_time / mapped_time << std::endl;
+
+    std::remove("benchmark_weights.txt");
+    std::remove("benchmark_biases.txt");
+    std::remove("benchmark_checkpoint.bin");
+    return 0;
+}
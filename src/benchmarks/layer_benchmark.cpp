@@ -0,0 +1,102 @@
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../include/layer.h"
+#include "../include/matrix.h"
+#include "../include/neural_network.h"
+#include "benchmark.h"
+
+/*
+    Benchmark: layer_benchmark
+
+    Description: Measures the per-forward latency of the 10 -> 128 -> 128 -> 4 network built in
+        DQN::DQN, and compares it with the previous nested std::vector layer implementation. Also
+        reports the latency of a single sample backward pass and of a 128 sample gemm through the
+        hidden layer.
+*/
+
+// The previous Layer implementation, with one heap allocated std::vector per weight row.
+struct NestedLayer {
+    std::vector<std::vector<float>> weights;
+    std::vector<float> biases;
+    std::vector<float> outputs;
+
+    NestedLayer(int input_size, int output_size, std::mt19937& gen) {
+        std::uniform_real_distribution<> dis(0.0, 0.1);
+        weights.resize(output_size, std::vector<float>(input_size));
+        biases.resize(output_size, 0.01f);
+        for (auto& row : weights) {
+            for (auto& val : row) {
+                val = dis(gen);
+            }
+        }
+    }
+
+    std::vector<float> forward(const std::vector<float>& input) {
+        outputs.resize(biases.size());
+        for (size_t i = 0; i < biases.size(); i++) {
+            outputs[i] = biases[i];
+            for (size_t j = 0; j < input.size(); j++) {
+                outputs[i] += weights[i][j] * input[j];
+            } outputs[i] = relu(outputs[i]);
+        }
+        return outputs;
+    }
+};
+
+int main() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+
+    std::vector<float> state(10);
+    for (auto& value : state) {
+        value = dis(gen);
+    }
+
+    NeuralNetwork network(0.0001);
+    network.add_layer(10, 128);
+    network.add_layer(128, 128);
+    network.add_layer(128, 4);
+
+    std::vector<NestedLayer> nested = {NestedLayer(10, 128, gen), NestedLayer(128, 128, gen), NestedLayer(128, 4, gen)};
+
+    float sink = 0;
+    double nested_forward = nanosecondsPerCall([&]() {
+        std::vector<float> output = state;
+        for (auto& layer : nested) {
+            output = layer.forward(output);
+        }
+        sink += output[0];
+    });
+    double contiguous_forward = nanosecondsPerCall([&]() {
+        sink += network.forward(state)[0];
+    });
+
+    std::vector<float> grad = {0.001f, -0.001f, 0.0f, 0.0f};
+    double contiguous_backward = nanosecondsPerCall([&]() {
+        network.forward(state);
+        network.backward(grad);
+    });
+
+    const int batch = 128;
+    Layer& hidden = network.layers[1];
+    std::vector<float> batch_inputs(batch * hidden.stride);
+    std::vector<float> batch_outputs(batch * hidden.output_size);
+    for (auto& value : batch_inputs) {
+        value = dis(gen);
+    }
+    double batch_gemm = nanosecondsPerCall([&]() {
+        gemm(false, true, batch, hidden.output_size, hidden.input_size, 1.0f, batch_inputs.data(), hidden.stride,
+             hidden.weights.data(), hidden.stride, 0.0f, batch_outputs.data(), hidden.output_size);
+        sink += batch_outputs[0];
+    });
+
+    std::cout << "network 10 -> 128 -> 128 -> 4" << std::endl;
+    std::cout << "nested vector forward:       " << nested_forward << " ns" << std::endl;
+    std::cout << "contiguous forward:          " << contiguous_forward << " ns" << std::endl;
+    std::cout << "contiguous forward+backward: " << contiguous_backward << " ns" << std::endl;
+    std::cout << "128x128 gemm, batch 128:     " << batch_gemm << " ns" << std::endl;
+    std::cout << "(checksum " << sink << ")" << std::endl;
+    return 0;
+}
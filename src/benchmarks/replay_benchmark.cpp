@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../include/dqn.h"
+#include "benchmark.h"
+
+/*
+    Benchmark: replay_benchmark
+
+    Description: Measures replay memory sampling throughput, in sampled experiences per second,
+        at batch 128 and 1024 from a full 30000 experience memory. Compares the index sampler
+        (Floyd's algorithm) and the full sample gathered into batch matrices against the previous
+        sampler, which constructed a std::random_device and std::mt19937 on every call.
+*/
+
+// The previous sampler, with the experiences copied into a vector of Experience structs.
+std::vector<ReplayMemory::Experience> previousSample(const ReplayMemory& memory, size_t batch_size) {
+    std::vector<ReplayMemory::Experience> batch;
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dist(0, memory.size - 1);
+    for (size_t i = 0; i < batch_size; i++) {
+        int pos = dist(gen);
+        batch.push_back({std::vector<float>(memory.state(pos), memory.state(pos) + memory.state_size), memory.actions[pos],
+                         memory.rewards[pos], std::vector<float>(memory.nextState(pos), memory.nextState(pos) + memory.state_size),
+                         (bool)memory.dones[pos]});
+    }
+    return batch;
+}
+
+template <typename Function>
+double samplesPerSecond(size_t batch_size, Function function) {
+    return batch_size * 1e9 / nanosecondsPerCall(function);
+}
+
+int main() {
+    const size_t capacity = 30000;
+    const size_t state_size = 10;
+    ReplayMemory memory(capacity, state_size, 42, false, 0.6f, 0.01f);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dis(0.0, 1.0);
+    std::vector<float> state(state_size), next_state(state_size);
+    for (size_t i = 0; i < capacity; i++) {
+        for (size_t j = 0; j < state_size; j++) {
+            state[j] = dis(gen);
+            next_state[j] = dis(gen);
+        }
+        memory.storeExperience(state.data(), i % 4, dis(gen), next_state.data(), i % 50 == 0);
+    }
+
+    std::vector<size_t> indices;
+    ReplayMemory::Batch batch;
+    size_t sink = 0;
+
+    std::cout << "batch   previous (samples/s)   indices (samples/s)   gathered batch (samples/s)" << std::endl;
+    for (size_t batch_size : {128, 1024}) {
+        double previous = samplesPerSecond(batch_size, [&]() { sink += previousSample(memory, batch_size).size(); });
+        double index = samplesPerSecond(batch_size, [&]() {
+            memory.sampleIndices(batch_size, indices);
+            sink += indices[0];
+        });
+        double gathered = samplesPerSecond(batch_size, [&]() {
+            memory.sample(batch_size, batch);
+            sink += batch.actions[0];
+        });
+        std::cout << batch_size << "\t" << previous << "\t\t" << index << "\t\t" << gathered << std::endl;
+    }
+    std::cout << "(checksum " << sink << ")" << std::endl;
+    return 0;
+}
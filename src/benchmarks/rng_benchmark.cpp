@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../include/rng.h"
+#include "benchmark.h"
+
+/*
+    Benchmark: rng_benchmark
+
+    Description: Measures the cost of the random draws made while training with Rng against the
+        standard library generators they replaced: a bounded integer draw (a replay sample index
+        or a random action), a float draw (the epsilon test), and seeding a generator, which the
+        layer initialisation used to do with a std::random_device and std::mt19937 per layer.
+*/
+
+int main() {
+    std::mt19937 mt(42);
+    Rng rng(42);
+    uint64_t sink = 0;
+    uint32_t bound = 30000;
+
+    double mt_below = nanosecondsPerCall([&]() { sink += std::uniform_int_distribution<uint32_t>(0, bound - 1)(mt); bound ^= 1; });
+    double rng_below = nanosecondsPerCall([&]() { sink += rng.below(bound); bound ^= 1; });
+
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    double mt_uniform = nanosecondsPerCall([&]() { sink += uniform(mt) > 0.5f; });
+    double rng_uniform = nanosecondsPerCall([&]() { sink += rng.uniform() > 0.5f; });
+
+    double mt_seed = nanosecondsPerCall([&]() { std::random_device device; std::mt19937 generator(device()); sink += generator(); });
+    double rng_seed = nanosecondsPerCall([&]() { Rng generator(sink, RNG_STREAM_LAYER_INIT); sink += generator(); });
+
+    // Draws of below over a small range should be uniform.
+    std::vector<long> counts(7, 0);
+    for (int i = 0; i < 7000000; i++) {
+        counts[rng.below(7)]++;
+    }
+    double max_deviation = 0;
+    for (long count : counts) {
+        max_deviation = std::max(max_deviation, std::abs(count - 1000000.0) / 1000000.0);
+    }
+
+    std::cout << "bounded int: mt19937 " << mt_below << " ns ::: Rng " << rng_below << " ns ::: speedup " << mt_below / rng_below << "x" << std::endl;
+    std::cout << "float:       mt19937 " << mt_uniform << " ns ::: Rng " << rng_uniform << " ns ::: speedup " << mt_uniform / rng_uniform << "x" << std::endl;
+    std::cout << "seeding:     random_device + mt19937 " << mt_seed << " ns ::: Rng " << rng_seed << " ns ::: speedup " << mt_seed / rng_seed << "x" << std::endl;
+    std::cout << "below(7) largest deviation from uniform: " << max_deviation * 100 << "% (checksum " << sink << ")" << std::endl;
+    return 0;
+}
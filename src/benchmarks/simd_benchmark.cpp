@@ -0,0 +1,72 @@
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../include/neural_network.h"
+#include "../include/simd_kernels.h"
+#include "benchmark.h"
+
+/*
+    Benchmark: simd_benchmark
+
+    Description: Compares the scalar kernels (the loops the layers used before) with the SSE,
+        AVX2 and AVX-512 kernels on the dot product, rank one update (axpy) and fused bias + relu
+        at the hidden layer width of 128, and on full forward and backward passes of the
+        10 -> 128 -> 128 -> 4 network at batch 1 and batch 128. Instruction sets which this CPU
+        does not support are skipped.
+*/
+
+int main() {
+    const int width = 128;
+    const int batch_size = 128;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dis(-1.0, 1.0);
+
+    std::vector<float> a(width), b(width), y(width);
+    for (int i = 0; i < width; i++) {
+        a[i] = dis(gen);
+        b[i] = dis(gen);
+    }
+
+    std::vector<float> state(10);
+    std::vector<float> states(batch_size * 10);
+    for (auto& value : state) value = dis(gen);
+    for (auto& value : states) value = dis(gen);
+    std::vector<float> grad = {0.001f, -0.001f, 0.0f, 0.0f};
+    std::vector<float> batch_grad(batch_size * 4, 0.0001f);
+
+    NeuralNetwork network(0.0001);
+    network.add_layer(10, 128);
+    network.add_layer(128, 128);
+    network.add_layer(128, 4);
+
+    std::cout << "detected: " << simdKernelsFor(detectSimdLevel())->name << std::endl;
+    std::cout << "kernel   dot(128)  axpy(128)  bias_relu(128)  forward  forward+backward  batch128 forward+backward" << std::endl;
+
+    float sink = 0;
+    for (int level = SIMD_SCALAR; level <= SIMD_AVX512; level++) {
+        const SimdKernels* kernels = simdKernelsFor((SimdLevel)level);
+        if (kernels == nullptr) {
+            continue;
+        }
+        setSimdLevel((SimdLevel)level);
+
+        double dot = nanosecondsPerCall([&]() { sink += kernels->dot(a.data(), b.data(), width); });
+        double axpy = nanosecondsPerCall([&]() { kernels->axpy(1e-6f, a.data(), y.data(), width); });
+        double bias_relu = nanosecondsPerCall([&]() { kernels->bias_relu(b.data(), y.data(), width); });
+        double forward = nanosecondsPerCall([&]() { sink += network.forward(state)[0]; });
+        double backward = nanosecondsPerCall([&]() {
+            network.forward(state);
+            network.backward(grad);
+        });
+        double batch = nanosecondsPerCall([&]() {
+            network.forward_batch(states, batch_size);
+            network.backward_batch(batch_grad, batch_size);
+        });
+
+        std::cout << kernels->name << "\t" << dot << " ns\t" << axpy << " ns\t" << bias_relu << " ns\t"
+                  << forward << " ns\t" << backward << " ns\t" << batch << " ns" << std::endl;
+    }
+    std::cout << "(checksum " << sink + y[0] << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../include/transition_queue.h"
+
+/*
+    Benchmark: transition_queue_benchmark
+
+    Description: Measures transition queue throughput, in transitions per second through the
+        queue, against the number of producer threads, with one consumer draining in bulk as the
+        learner does. Compares the lock-free queue against the previous queue, which took a mutex
+        for every push and swapped buffers under the mutex to drain.
+*/
+
+// The previous queue.
+class MutexQueue {
+public:
+    std::vector<Transition> buffer;
+    size_t capacity;
+    std::mutex mutex;
+    std::condition_variable not_full;
+
+    MutexQueue(size_t capacity) : capacity(capacity) { buffer.reserve(capacity); }
+
+    void push(const Transition& transition) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]() { return buffer.size() < capacity; });
+        buffer.push_back(transition);
+    }
+
+    size_t drain(std::vector<Transition>& out) {
+        out.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffer.swap(out);
+        }
+        not_full.notify_all();
+        return out.size();
+    }
+};
+
+const size_t CAPACITY = 4096;
+
+template <typename Push, typename Drain>
+double transitionsPerSecond(int producers, long per_producer, Push push, Drain drain) {
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            Transition transition = {};
+            transition.action = p;
+            while (!start.load()) std::this_thread::yield();
+            for (long s = 0; s < per_producer; s++) {
+                transition.reward = (float)s;
+                push(transition);
+            }
+        });
+    }
+
+    long total = producers * per_producer;
+    long received = 0;
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    while (received < total) {
+        size_t count = drain();
+        if (count == 0) std::this_thread::yield();
+        received += count;
+    }
+    auto end = std::chrono::steady_clock::now();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return total / std::chrono::duration<double>(end - begin).count();
+}
+
+int main() {
+    const long total = 2000000;
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+
+    for (int producers : {1, 2, 4, 8}) {
+        long per_producer = total / producers;
+
+        TransitionQueue lock_free(CAPACITY);
+        float sink = 0;
+        double lock_free_rate = transitionsPerSecond(producers, per_producer,
+            [&](const Transition& transition) {
+                while (!lock_free.tryPush(transition)) std::this_thread::yield();
+            },
+            [&]() {
+                return lock_free.drain([&](const Transition& transition) { sink += transition.reward; }, CAPACITY);
+            });
+
+        MutexQueue mutex_queue(CAPACITY);
+        std::vector<Transition> received;
+        received.reserve(CAPACITY);
+        double mutex_rate = transitionsPerSecond(producers, per_producer,
+            [&](const Transition& transition) { mutex_queue.push(transition); },
+            [&]() {
+                size_t count = mutex_queue.drain(received);
+                for (const Transition& transition : received) sink += transition.reward;
+                return count;
+            });
+
+        std::cout << "producers: " << producers << " ::: lock-free: " << lock_free_rate << " transitions/sec"
+                  << " ::: mutex: " << mutex_rate << " transitions/sec ::: speedup: " << lock_free_rate / mutex_rate
+                  << " ::: (" << sink << ")" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../include/transition_queue.h"
+
+/*
+    Benchmark: transition_queue_stress
+
+    Description: Stress test of the lock-free transition queue. Several producer threads push
+        numbered transitions through a small queue, so that it is full most of the time and the
+        producers keep wrapping around it, while one consumer drains. Checks that every
+        transition arrives exactly once, in order per producer, with its payload intact. Returns
+        a non-zero exit code on any failure.
+*/
+
+// Every float of the payload is derived from the producer and sequence number, so a transition
+// which was torn by a racing write does not match.
+void fillTransition(Transition& transition, int producer, int sequence) {
+    for (int i = 0; i < STATE_SIZE; i++) {
+        transition.state[i] = producer * 1000003.0f + sequence + i;
+        transition.next_state[i] = -transition.state[i];
+    }
+    transition.action = producer;
+    transition.reward = (float)sequence;
+    transition.done = sequence % 2;
+}
+
+bool checkTransition(const Transition& transition, int producer, int sequence) {
+    Transition expected;
+    fillTransition(expected, producer, sequence);
+    for (int i = 0; i < STATE_SIZE; i++) {
+        if (transition.state[i] != expected.state[i] || transition.next_state[i] != expected.next_state[i]) return false;
+    }
+    return transition.reward == expected.reward && transition.done == expected.done;
+}
+
+int runStress(int producers, int per_producer, size_t capacity) {
+    TransitionQueue queue(capacity);
+    std::atomic<bool> start(false);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            while (!start.load()) std::this_thread::yield();
+            Transition transition;
+            for (int s = 0; s < per_producer; s++) {
+                fillTransition(transition, p, s);
+                while (!queue.tryPush(transition)) std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<int> next_sequence(producers, 0);
+    long received = 0;
+    long failures = 0;
+    auto consume = [&](const Transition& transition) {
+        int producer = transition.action;
+        if (producer < 0 || producer >= producers) {
+            failures++;
+            return;
+        }
+        int sequence = (int)transition.reward;
+        if (sequence != next_sequence[producer] || !checkTransition(transition, producer, sequence)) {
+            failures++;
+        }
+        next_sequence[producer] = sequence + 1;
+        received++;
+    };
+
+    long total = (long)producers * per_producer;
+    start.store(true);
+    while (received + failures < total) {
+        if (queue.drain(consume, 64) == 0) std::this_thread::yield();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (queue.drain(consume, queue.capacity) != 0) failures++;
+
+    std::cout << "producers: " << producers << " ::: capacity: " << queue.capacity << " ::: received: " << received
+              << " ::: failures: " << failures << std::endl;
+    return failures == 0 && received == total ? 0 : 1;
+}
+
+int main() {
+    int failed = 0;
+    failed |= runStress(1, 200000, 4);
+    failed |= runStress(2, 200000, 8);
+    failed |= runStress(4, 100000, 16);
+    failed |= runStress(8, 50000, 64);
+    failed |= runStress(16, 20000, 4096);
+
+    std::cout << (failed ? "FAILED" : "PASSED") << std::endl;
+    return failed;
+}
@@ -1 +1 @@
-g++ src/*.cpp -o test_trained_version -Iinclude/ -lraylib -Iexternal_libraries/include/ -Lexternal_libraries/bin/ -lraylib -lopengl32 -lgdi32 -lwinmm
\ No newline at end of file
+g++ -O2 -pthread src/*.cpp -o test_trained_version -Iinclude/ -lraylib -Iexternal_libraries/include/ -Lexternal_libraries/bin/ -lraylib -lopengl32 -lgdi32 -lwinmm
\ No newline at end of file
@@ -0,0 +1,10 @@
+g++ -O2 benchmarks/layer_benchmark.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/simd_kernels.cpp -o layer_benchmark -Iinclude/
+g++ -O2 benchmarks/simd_benchmark.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/simd_kernels.cpp -o simd_benchmark -Iinclude/
+g++ -O2 benchmarks/replay_benchmark.cpp src/dqn.cpp src/game.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/simd_kernels.cpp src/sum_tree.cpp -o replay_benchmark -Iinclude/ -Iexternal_libraries/include/ -Lexternal_libraries/bin/ -lraylib -lopengl32 -lgdi32 -lwinmm
+g++ -O2 benchmarks/action_benchmark.cpp src/dqn.cpp src/game.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/simd_kernels.cpp src/sum_tree.cpp -o action_benchmark -Iinclude/ -Iexternal_libraries/include/ -Lexternal_libraries/bin/ -lraylib -lopengl32 -lgdi32 -lwinmm
+g++ -O2 -pthread benchmarks/transition_queue_stress.cpp src/transition_queue.cpp -o transition_queue_stress -Iinclude/ -Iexternal_libraries/include/
+g++ -O2 -pthread benchmarks/transition_queue_benchmark.cpp src/transition_queue.cpp -o transition_queue_benchmark -Iinclude/ -Iexternal_libraries/include/
+g++ -O2 benchmarks/checkpoint_benchmark.cpp src/checkpoint.cpp src/file_reader.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/simd_kernels.cpp -o checkpoint_benchmark -Iinclude/
+
+g++ -O2 benchmarks/rng_benchmark.cpp src/rng.cpp -o rng_benchmark -Iinclude/
+g++ -O2 -pthread benchmarks/benchmark_suite.cpp src/dqn.cpp src/environment.cpp src/game.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/reward.cpp src/simd_kernels.cpp src/sum_tree.cpp -o benchmark_suite -Iinclude/ -Iexternal_libraries/include/ -Lexternal_libraries/bin/ -lraylib -lopengl32 -lgdi32 -lwinmm
\ No newline at end of file
@@ -0,0 +1,2 @@
+g++ -O2 -pthread tests/state_encoder_test.cpp src/dqn.cpp src/environment.cpp src/game.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/reward.cpp src/simd_kernels.cpp src/sum_tree.cpp -o state_encoder_test -Iinclude/ -Iexternal_libraries/include/ -Lexternal_libraries/bin/ -lraylib -lopengl32 -lgdi32 -lwinmm
+g++ -O2 -pthread tests/actor_learner_test.cpp src/actor_learner.cpp src/dqn.cpp src/environment.cpp src/game.cpp src/layer.cpp src/logger.cpp src/matrix.cpp src/neural_network.cpp src/optimiser.cpp src/rng.cpp src/reward.cpp src/simd_kernels.cpp src/sum_tree.cpp src/transition_queue.cpp -o actor_learner_test -Iinclude/ -Iexternal_libraries/include/ -Lexternal_libraries/bin/ -lraylib -lopengl32 -lgdi32 -lwinmm
\ No newline at end of file
@@ -0,0 +1 @@
+g++ -O2 tools/trace_decoder.cpp src/trace_writer.cpp -o trace_decoder -Iinclude/ -Iexternal_libraries/include/
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef ACTOR_LEARNER_H
+#define ACTOR_LEARNER_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../include/dqn.h"
+#include "../include/environment.h"
+#include "../include/game_params.h"
+#include "../include/network_params.h"
+#include "../include/transition_queue.h"
+
+// The policy parameters the actors select actions with. The learner publishes a copy of its
+// policy network every WEIGHT_PUBLISH_INTERVAL training steps, each actor picks it up into its
+// own network before its next step.
+class PolicyPublisher {
+public:
+    NeuralNetwork network;
+    std::atomic<int> version;
+    std::mutex mutex;
+
+    PolicyPublisher(const NeuralNetwork& policy);
+
+    void publish(const NeuralNetwork& policy);
+    bool fetch(NeuralNetwork& local, int& local_version);
+};
+
+// Headless training split over threads. NUM_ACTORS actor threads each step NUM_ENVIRONMENTS
+// games of their own with a local copy of the policy and push their transitions to a lock-free
+// queue. The calling thread is the learner: it drains the queue into the DQN's replay memory,
+// REPLAY_RATIO training steps per transition once sampling starts, and publishes the new weights.
+// The actors wait while the queue is full, so they never run more than a queue ahead of training.
+class ActorLearner {
+public:
+    DQN& dqn;
+    GameParams game_params;
+    NetworkParams params;
+    TransitionQueue queue;
+    PolicyPublisher publisher;
+    std::atomic<bool> stop;
+    std::atomic<long> actor_steps; // Steps taken by all actors, drives the exploration schedule.
+    long steps;                    // Transitions received by the learner.
+    long games_played;
+    long train_steps;
+
+    ActorLearner(DQN& dqn, const GameParams& game_params, const NetworkParams& params);
+
+    void run();
+
+private:
+    bool budgetRemaining() const;
+    void actorLoop(int actor);
+    float epsilon(long step) const;
+};
+
+#endif
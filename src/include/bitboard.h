@@ -0,0 +1,60 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+// Largest supported board. Fixes the storage of the bitboard, the snake body and the free cell
+// list so that all three can be copied with a flat memcpy, at the cost of sizing them for this
+// board whatever the configured cell_count. Builds which only use smaller boards can shrink them
+// with -DSNAKE_MAX_CELL_COUNT, e.g. 8 for the default board.
+#ifndef SNAKE_MAX_CELL_COUNT
+#define SNAKE_MAX_CELL_COUNT 32
+#endif
+const int MAX_CELL_COUNT = SNAKE_MAX_CELL_COUNT;
+
+// One bit per cell of a cell_count x cell_count board. Every row and every column is kept as its own
+// mask, so setting a cell updates two words and a whole line of cells can be scanned with one bit
+// operation, see freeRun.
+class Bitboard {
+public:
+    uint64_t rows[MAX_CELL_COUNT];    // Bit x of rows[y] is cell (x, y).
+    uint64_t columns[MAX_CELL_COUNT]; // Bit y of columns[x] is cell (x, y), the transpose of rows.
+    int cell_count;
+
+    Bitboard(int cell_count) : rows(), columns(), cell_count(cell_count) {}
+
+    bool inside(int x, int y) const { return x >= 0 && x < cell_count && y >= 0 && y < cell_count; }
+
+    bool test(int x, int y) const { return (rows[y] >> x) & 1; }
+    void set(int x, int y) {
+        rows[y] |= uint64_t(1) << x;
+        columns[x] |= uint64_t(1) << y;
+    }
+    void reset(int x, int y) {
+        rows[y] &= ~(uint64_t(1) << x);
+        columns[x] &= ~(uint64_t(1) << y);
+    }
+    void clear() {
+        for (int i = 0; i < cell_count; i++) {
+            rows[i] = 0;
+            columns[i] = 0;
+        }
+    }
+
+    // Number of clear cells walking from (x, y) in the direction (dx, dy), not counting (x, y) itself,
+    // before reaching a set cell or the edge of the board. (x, y) must be inside the board. Walking
+    // towards higher indices a sentinel bit stands in for the edge and the answer is the count of
+    // trailing zeros, walking towards lower indices it is the distance to the highest set bit below.
+    int freeRun(int x, int y, int dx, int dy) const {
+        uint64_t line = dx != 0 ? rows[y] : columns[x];
+        int position = dx != 0 ? x : y;
+        if (dx + dy > 0) {
+            uint64_t ahead = (line >> (position + 1)) | (uint64_t(1) << (cell_count - position - 1));
+            return __builtin_ctzll(ahead);
+        }
+        uint64_t behind = line & ((uint64_t(1) << position) - 1);
+        return behind != 0 ? position - 1 - (63 - __builtin_clzll(behind)) : position;
+    }
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../include/neural_network.h"
+
+// Binary checkpoint of a network's parameters. The file is a fixed header, one shape record per
+// layer, zero padding up to payload_offset, then the network's parameter buffer exactly as it is
+// in memory, padding included. The payload starts on a MATRIX_ALIGNMENT boundary of the file,
+// so a memory mapped checkpoint can be evaluated in place. Fields are little endian.
+const char CHECKPOINT_MAGIC[8] = {'S', 'N', 'A', 'K', 'E', 'D', 'Q', 'N'};
+const uint32_t CHECKPOINT_VERSION = 1;
+const uint32_t CHECKPOINT_BYTE_ORDER = 0x01020304; // Reads back differently on a big endian machine.
+
+enum CheckpointDtype : uint32_t { CHECKPOINT_FLOAT32 = 1 };
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t dtype;
+    uint32_t alignment;      // The MATRIX_ALIGNMENT the payload was padded for.
+    uint32_t layer_count;
+    uint32_t reserved;
+    uint64_t payload_offset; // Bytes from the start of the file.
+    uint64_t payload_size;   // Bytes.
+    uint64_t checksum;       // 64 bit FNV-1a of the payload.
+};
+
+struct CheckpointLayer {
+    uint32_t input_size;
+    uint32_t output_size;
+};
+
+uint64_t checkpointChecksum(const void* data, size_t size);
+void saveCheckpoint(const std::string& filepath, const NeuralNetwork& network);
+void loadCheckpoint(const std::string& filepath, NeuralNetwork& network);
+
+// A checkpoint file mapped into memory, with a network whose layers view the mapped payload. The
+// network is valid while the MappedCheckpoint exists, and is for inference only. Pages are
+// mapped copy on write, the file itself is never modified.
+class MappedCheckpoint {
+public:
+    const CheckpointHeader* header;
+    const CheckpointLayer* layer_shapes;
+    NeuralNetwork network;
+
+    MappedCheckpoint(const std::string& filepath);
+    ~MappedCheckpoint();
+
+    MappedCheckpoint(const MappedCheckpoint&) = delete;
+    MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+
+private:
+    void* data;
+    size_t size;
+    void* file_handle;    // Windows only, the file and mapping handles to close.
+    void* mapping_handle;
+
+    void map(const std::string& filepath);
+    void unmap();
+    void validate(const std::string& filepath) const;
+};
+
+#endif
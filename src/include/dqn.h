@@ -1,15 +1,16 @@
 #ifndef DQN_H
 #define DQN_H
 
+#include <cstdint>
 #include <iostream>
-#include <random>
 #include <vector>
 
 #include "../include/game.h"
 #include "../include/neural_network.h"
 #include "../include/network_params.h"
+#include "../include/rng.h"
+#include "../include/sum_tree.h"
 
-float getReward(const Snake &snake, const Food &food, const Vector2 &previous_head_position);
 std::vector<float> getState(const Snake &snake, const Food &food);
 
 class ReplayMemory {
@@ -22,14 +23,55 @@ public:
         bool done;
     };
 
-    std::vector<Experience> memory;
+    // A sampled minibatch, one experience per row. The buffers are reused between samples.
+    struct Batch {
+        std::vector<size_t> indices;    // Positions in the replay memory of the sampled experiences.
+        std::vector<float> states;      // batch_size x state_size
+        std::vector<int> actions;
+        std::vector<float> rewards;
+        std::vector<float> next_states; // batch_size x state_size
+        std::vector<uint8_t> dones;
+        std::vector<float> weights;     // Importance sampling weights, all one for uniform sampling.
+    };
+
+    // Experiences are stored as a structure of arrays, preallocated to capacity, with the states
+    // and next states as capacity x state_size row-major matrices.
+    std::vector<float> states;
+    std::vector<int> actions;
+    std::vector<float> rewards;
+    std::vector<float> next_states;
+    std::vector<uint8_t> dones;
     size_t capacity;
+    size_t state_size;
+    size_t size;
     size_t position;
 
-    ReplayMemory(size_t capacity);
+    // Sampling state. The generator persists between samples, and selected marks the positions
+    // already chosen for the current sample.
+    Rng generator;
+    std::vector<uint8_t> selected;
+
+    // Prioritized replay. Each experience is sampled with probability proportional to its
+    // priority (|td error| + priority_epsilon)^priority_alpha, held in the sum tree.
+    bool prioritized;
+    float priority_alpha;
+    float priority_epsilon;
+    float priority_beta; // Importance sampling correction, annealed towards 1 by the DQN.
+    float max_priority;
+    SumTree priorities;
+
+    ReplayMemory(size_t capacity, size_t state_size, uint64_t seed, bool prioritized, float priority_alpha, float priority_epsilon);
 
+    const float* state(size_t index) const { return states.data() + index * state_size; }
+    const float* nextState(size_t index) const { return next_states.data() + index * state_size; }
+
+    void seed(uint64_t seed);
     void storeExperience(const Experience& experience);
-    std::vector<Experience> sample(size_t batch_size);
+    void storeExperience(const float* state, int action, float reward, const float* next_state, bool done);
+    void sampleIndices(size_t batch_size, std::vector<size_t>& indices);
+    void samplePrioritized(size_t batch_size, std::vector<size_t>& indices, std::vector<float>& weights);
+    void sample(size_t batch_size, Batch& batch);
+    void updatePriorities(const std::vector<size_t>& indices, const std::vector<float>& td_errors);
 };
 
 class DQN {
@@ -39,14 +81,33 @@ public:
     ReplayMemory replay_memory;
     NetworkParams params;
     int steps_done;
+    int train_steps;
+
+    // Actions chosen since the last action summary, see ACTION_SUMMARY_INTERVAL.
+    long random_actions;
+    long greedy_actions;
+
+    // Minibatch buffers for train, each batch_size rows.
+    ReplayMemory::Batch batch;
+    std::vector<float> batch_grad;
+    std::vector<float> batch_td_errors;
+
+    // Inference scratch memory, sized once for the networks.
+    Rng action_generator;
+    NeuralNetwork::Workspace action_workspace; // One state, for action selection.
+    NeuralNetwork::Workspace states_workspace; // The states of many games, for selectActionsTrain.
+    NeuralNetwork::Workspace target_workspace; // A minibatch of next states, for train.
 
     DQN(int input_size, int output_size, size_t memory_capacity, const NetworkParams& params);
 
     void updateTargetNet();
     void train(int batch_size);
-    int argmax(std::vector<float> q_values);
-    int selectActionTrain(const std::vector<float>& state, NeuralNetwork policy_net, int episode_number);
-    int selectActionTest(const std::vector<float>& state, NeuralNetwork policy_net);
+    int argmax(const float* q_values, int size);
+    const float* qValues(const float* state);
+    int selectActionTrain(const float* state, int episode_number);
+    void selectActionsTrain(const float* states, int num_states, int episode_number, int* actions);
+    void countAction(bool greedy, float epsilon);
+    int selectActionTest(const float* state);
 };
 
 #endif
\ No newline at end of file
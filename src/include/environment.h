@@ -0,0 +1,56 @@
+#ifndef ENVIRONMENT_H
+#define ENVIRONMENT_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../include/game.h"
+#include "../include/game_params.h"
+#include "../include/network_params.h"
+#include "../include/reward.h"
+
+// Size of the state vector returned by getState and the number of actions the snake can take.
+const int STATE_SIZE = 10;
+const int ACTION_SIZE = 4;
+
+enum Actions { UP, DOWN, LEFT, RIGHT };
+
+void applyAction(Game &game, int action);
+
+// Writes the same features as getState straight into a row of a states matrix, without allocating.
+// The snake keeps its occupancy bitboard in step with the head and tail change of every move, so
+// each obstacle distance is one bit scan of the head's row or column instead of a walk over cells.
+class StateEncoder {
+public:
+    int cell_count;
+
+    StateEncoder(const GameParams& params);
+
+    void encode(const Snake& snake, const Food& food, float* state) const;
+
+private:
+    int obstacleDistance(const Snake& snake, int dx, int dy) const;
+};
+
+class VectorEnvironment {
+public:
+    std::vector<Game> games;
+    std::vector<float> states;          // num_envs x STATE_SIZE, the current state of every game.
+    std::vector<float> previous_states; // num_envs x STATE_SIZE, the states the last actions were selected from.
+    std::vector<float> rewards;         // num_envs, the reward of the last step.
+    std::vector<uint8_t> dones;         // num_envs, whether the last step reached a terminal state.
+    std::vector<Cell> previous_head_positions;
+    StateEncoder encoder;
+    RewardEngine reward_engine;
+    int num_envs;
+
+    VectorEnvironment(int num_envs, const GameParams& params, const NetworkParams& network_params);
+
+    const float* state(int env) const;
+    const float* previousState(int env) const;
+
+    void reset();
+    void step(const std::vector<int>& actions);
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef FREE_CELLS_H
+#define FREE_CELLS_H
+
+#include <cstdint>
+
+#include "../include/bitboard.h"
+#include "../include/snake_body.h"
+
+// The cells of a cell_count x cell_count board which are not covered by the snake, as an unordered
+// array with an index back into it for every cell. Adding or removing a cell is O(1), removal moves
+// the last free cell into the gap, and a uniformly random free cell is one array lookup. Cells are
+// numbered y * cell_count + x, as in Bitboard.
+class FreeCellList {
+public:
+    int16_t cells[MAX_CELL_COUNT * MAX_CELL_COUNT]; // cells[0, count) are the free cells, in no order.
+    int16_t slots[MAX_CELL_COUNT * MAX_CELL_COUNT]; // slots[cell] is the position of a free cell in cells.
+    int count;
+    int cell_count;
+
+    FreeCellList(int cell_count) : cells(), slots(), count(0), cell_count(cell_count) { fill(); }
+
+    int size() const { return count; }
+    Cell at(int i) const { return Cell{(int16_t)(cells[i] % cell_count), (int16_t)(cells[i] / cell_count)}; }
+
+    void fill() {
+        count = cell_count * cell_count;
+        for (int cell = 0; cell < count; cell++) {
+            cells[cell] = cell;
+            slots[cell] = cell;
+        }
+    }
+    void add(int x, int y) {
+        int cell = y * cell_count + x;
+        slots[cell] = count;
+        cells[count++] = cell;
+    }
+    void remove(int x, int y) {
+        int slot = slots[y * cell_count + x];
+        int last = cells[--count];
+        cells[slot] = last;
+        slots[last] = slot;
+    }
+};
+
+#endif
@@ -1,9 +1,14 @@
 #ifndef GAME_H
 #define GAME_H
 
-#include <deque>
 #include <iostream>
+#include <type_traits>
+
+#include "../include/bitboard.h"
+#include "../include/free_cells.h"
 #include "../include/game_params.h"
+#include "../include/rng.h"
+#include "../include/snake_body.h"
 #include "../external_libraries/include/raylib.h"
 #include "../external_libraries/include/raymath.h"
 
@@ -12,32 +17,66 @@ struct eventResult {
     float last_update_time;
 };
 
-bool elementInDeque(Vector2 element, std::deque<Vector2> deque);
+Cell toCell(Vector2 position);
+
+// The settings of GameParams which the game itself uses, held by value in Snake, Food and Game.
+// GameParams keeps the start body in a std::deque, here it is a fixed array of cells, so that the
+// simulation objects are trivially copyable and copying a game is one flat copy.
+struct BoardParams {
+    static const int MAX_START_LENGTH = 16;
+
+    int cell_count;
+    int random_seed;
+    Cell start_body[MAX_START_LENGTH]; // start_body[0, start_length) is the initial body, head first.
+    int start_length;
+    Cell start_direction;
+    bool start_add_segment;
+
+    // Drawing parameters
+    int cell_size;
+    int offset;
+    Color dark_green;
+    Color white;
 
+    BoardParams(const GameParams& params);
+};
 
 class Snake {
 public:
-    std::deque<Vector2> body;
-    Vector2 direction;
+    SnakeBody body;       // Integer cell coordinates of every segment, head first.
+    Cell direction;
     bool add_segment;
-    GameParams params;
+    BoardParams params;
+    Bitboard occupancy;   // The cells covered by the body, updated incrementally with the body.
+    FreeCellList free_cells; // The cells of the board not in occupancy, for placing food.
+    bool head_collision;  // Whether the head overlaps the rest of the body.
+    bool overlapping;     // Set once two segments have shared a cell, until the next reset.
 
     Snake(const GameParams& params);
 
+    bool occupies(int x, int y) const { return occupancy.inside(x, y) && occupancy.test(x, y); }
+    bool occupies(Cell cell) const { return occupies(cell.x, cell.y); }
+    Cell head() const { return body.front(); }
+
     void draw();
     void update();
     void reset();
+    void rebuildOccupancy();
+
+private:
+    void occupy(Cell cell);
+    void vacate(Cell cell);
 };
 
 class Food {
 public:
-    Vector2 position;
-    GameParams params;
+    Cell position;
+    BoardParams params;
+    Rng generator;
 
-    Food(std::deque<Vector2> snake_body, const GameParams& params);
+    Food(const Snake& snake, const GameParams& params);
 
-    Vector2 generateRandomCell();
-    Vector2 generateRandomPos(std::deque<Vector2> snake_body);
+    Cell generateRandomPos(const Snake& snake);
     void draw();
 };
 
@@ -47,7 +86,7 @@ public:
     Food food;
     bool game_running;
     int score;
-    GameParams params;
+    BoardParams params;
     float last_update_time;
 
     Game(bool game_running, int score, const GameParams& params, float last_update_time);
@@ -61,5 +100,7 @@ public:
     void gameOver();
 };
 
+static_assert(std::is_trivially_copyable<Game>::value, "Game must stay trivially copyable, keep types such as std::deque out of BoardParams");
+
 
 #endif 
\ No newline at end of file
@@ -29,6 +29,9 @@ struct GameParams {
     std::deque<Vector2> body = {Vector2{3, 3}, Vector2{4, 3}};
     Vector2 direction = {0, 1};
 	bool add_segment = false;
+
+    // Food parameters
+    int random_seed = -1; // Seed of the food placement, -1 to seed from std::random_device.
 };
 
 #endif
\ No newline at end of file
@@ -3,22 +3,54 @@
 
 #include <vector>
 
+#include "../include/matrix.h"
+#include "../include/optimiser.h"
+#include "../include/rng.h"
+
 float relu(float x);
 float relu_derivative(float x);
 
 class Layer {
 public:
-    std::vector<std::vector<float>> weights;
-    std::vector<float> biases;
+    // Views of the layer's part of the parameter buffer of its network, see NeuralNetwork::parameters.
+    FloatSpan weights; // output_size x stride row-major, row i holds the weights of output i.
+    FloatSpan biases;  // output_size
     std::vector<float> outputs;
     std::vector<float> inputs;
     std::vector<float> deltas;
-    float learning_rate;
+    std::vector<float> output_deltas;
+
+    // Minibatch buffers, each row-major with one row per sample.
+    std::vector<float> batch_inputs;        // batch_size x input_size
+    std::vector<float> batch_outputs;       // batch_size x output_size
+    std::vector<float> batch_deltas;        // batch_size x input_size
+    std::vector<float> batch_output_deltas; // batch_size x output_size
+    AlignedVector weight_gradients;         // output_size x stride, same layout as weights.
+    std::vector<float> bias_gradients;
+
+    // Optimiser moments, moment_count() arrays laid out like the parameters, one after the other.
+    AlignedVector weight_moments;           // moment_count x output_size x stride
+    std::vector<float> bias_moments;        // moment_count x output_size
+
+    int input_size;
+    int output_size;
+    int stride;
+
+    Layer(int input_size, int output_size);
+    Layer(int input_size, int output_size, float* parameters, Rng& rng);
+
+    static size_t parameter_count(int input_size, int output_size);
+    void bind(float* parameters);
 
-    Layer(int input_size, int output_size, float learning_rate);
+    float* row(int i) { return weights.data() + i * stride; }
+    const float* row(int i) const { return weights.data() + i * stride; }
 
     std::vector<float> forward(const std::vector<float>& input);
+    void infer(const float* input, int batch_size, float* output) const;
     std::vector<float> backward(const std::vector<float>& grad);
+    const std::vector<float>& forward_batch(const std::vector<float>& input, int batch_size);
+    const std::vector<float>& backward_batch(const std::vector<float>& grad, int batch_size);
+    void apply_gradients(const Optimiser& optimiser);
 
     void load_in_params(std::vector<std::vector<float>>& loaded_weights, std::vector<float>& loaded_biases);
 };
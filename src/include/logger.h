@@ -0,0 +1,115 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// Leveled logging. Messages are stream expressions, LOG_INFO("steps: " << steps), and are only
+// formatted when they will be written.
+//
+// LOG_COMPILE_LEVEL removes every message below it in the preprocessor, arguments and all:
+// 0 trace, 1 debug, 2 info, 3 warn, 4 error, 5 nothing. Build with e.g. -DLOG_COMPILE_LEVEL=0
+// to keep the per step trace messages. Above it, logger().level filters at run time.
+//
+// The _EVERY variants write at most one message per interval from their call site and report how
+// many were suppressed in between, for messages in loops.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 1
+#endif
+
+enum LogLevel {
+    LOG_LEVEL_TRACE = 0,
+    LOG_LEVEL_DEBUG = 1,
+    LOG_LEVEL_INFO = 2,
+    LOG_LEVEL_WARN = 3,
+    LOG_LEVEL_ERROR = 4,
+    LOG_LEVEL_OFF = 5
+};
+
+class Logger {
+public:
+    LogLevel level; // Set before any other thread logs.
+    std::ostream* out;
+    std::mutex mutex;
+
+    Logger();
+
+    bool enabled(LogLevel message_level) const { return message_level >= level; }
+    void write(LogLevel message_level, const std::string& message);
+};
+
+Logger& logger();
+
+// Lets one message through per interval and counts the rest, safe to share between threads.
+class LogRateLimiter {
+public:
+    LogRateLimiter(double interval_seconds);
+
+    bool allow(uint64_t& suppressed);
+
+private:
+    int64_t interval;
+    std::atomic<int64_t> next_time;
+    std::atomic<uint64_t> suppressed_count;
+};
+
+#define LOG_AT(level, message) do { \
+    if (logger().enabled(level)) { \
+        std::ostringstream log_stream; \
+        log_stream << message; \
+        logger().write(level, log_stream.str()); \
+    } \
+} while (0)
+
+#define LOG_EVERY_AT(level, seconds, message) do { \
+    static LogRateLimiter log_limiter(seconds); \
+    uint64_t log_suppressed; \
+    if (logger().enabled(level) && log_limiter.allow(log_suppressed)) { \
+        std::ostringstream log_stream; \
+        log_stream << message; \
+        if (log_suppressed > 0) log_stream << " ::: " << log_suppressed << " similar suppressed"; \
+        logger().write(level, log_stream.str()); \
+    } \
+} while (0)
+
+#if LOG_COMPILE_LEVEL <= 0
+#define LOG_TRACE(message) LOG_AT(LOG_LEVEL_TRACE, message)
+#define LOG_TRACE_EVERY(seconds, message) LOG_EVERY_AT(LOG_LEVEL_TRACE, seconds, message)
+#else
+#define LOG_TRACE(message) do {} while (0)
+#define LOG_TRACE_EVERY(seconds, message) do {} while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define LOG_DEBUG(message) LOG_AT(LOG_LEVEL_DEBUG, message)
+#define LOG_DEBUG_EVERY(seconds, message) LOG_EVERY_AT(LOG_LEVEL_DEBUG, seconds, message)
+#else
+#define LOG_DEBUG(message) do {} while (0)
+#define LOG_DEBUG_EVERY(seconds, message) do {} while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 2
+#define LOG_INFO(message) LOG_AT(LOG_LEVEL_INFO, message)
+#define LOG_INFO_EVERY(seconds, message) LOG_EVERY_AT(LOG_LEVEL_INFO, seconds, message)
+#else
+#define LOG_INFO(message) do {} while (0)
+#define LOG_INFO_EVERY(seconds, message) do {} while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 3
+#define LOG_WARN(message) LOG_AT(LOG_LEVEL_WARN, message)
+#else
+#define LOG_WARN(message) do {} while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 4
+#define LOG_ERROR(message) LOG_AT(LOG_LEVEL_ERROR, message)
+#else
+#define LOG_ERROR(message) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Alignment in bytes of matrix buffers. One cache line, which is also the width of an AVX-512 register.
+const size_t MATRIX_ALIGNMENT = 64;
+
+// Allocator which aligns the start of a std::vector buffer to MATRIX_ALIGNMENT.
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(MATRIX_ALIGNMENT)));
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(MATRIX_ALIGNMENT));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+typedef std::vector<float, AlignedAllocator<float>> AlignedVector;
+
+// A run of floats inside a buffer owned by something else, with the parts of the std::vector
+// interface the layers use. Copying a span copies the view, not the floats.
+struct FloatSpan {
+    float* pointer;
+    size_t length;
+
+    FloatSpan() : pointer(nullptr), length(0) {}
+    FloatSpan(float* pointer, size_t length) : pointer(pointer), length(length) {}
+
+    float* data() { return pointer; }
+    const float* data() const { return pointer; }
+    size_t size() const { return length; }
+    float& operator[](size_t i) { return pointer[i]; }
+    const float& operator[](size_t i) const { return pointer[i]; }
+    float* begin() { return pointer; }
+    float* end() { return pointer + length; }
+    const float* begin() const { return pointer; }
+    const float* end() const { return pointer + length; }
+};
+
+int alignedStride(int cols);
+
+void gemv(const float* a, int rows, int cols, int lda, const float* x, float* y);
+void gemvTransposed(const float* a, int rows, int cols, int lda, const float* x, float* y);
+void rankOneUpdate(float* a, int rows, int cols, int lda, float alpha, const float* x, const float* y);
+void gemm(bool transpose_a, bool transpose_b, int m, int n, int k, float alpha,
+          const float* a, int lda, const float* b, int ldb, float beta, float* c, int ldc);
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <string>
 
+#include "../include/logger.h"
+#include "../include/optimiser.h"
+
 // Based to DQN class.
 struct NetworkParams {
     // Determines the memory capacity.
@@ -26,10 +29,27 @@ struct NetworkParams {
     float LEARNING_RATE = 0.0001; // Neural network parameter step update.
     int SAMPLING_THRESHOLD = 10000; // The point in which you start training once the memory capacity is full enough.
     int BATCH_SIZE = 128;
+    int RANDOM_SEED = -1; // Seed of the initial weights, replay memory sampler and action selection, each on its own stream, see rng.h. -1 to seed from std::random_device.
+
+    // Optimiser parameters, see optimiser.h.
+    OptimiserType OPTIMISER = OPTIMISER_SGD; // OPTIMISER_SGD, OPTIMISER_MOMENTUM, OPTIMISER_RMSPROP or OPTIMISER_ADAM.
+    float MOMENTUM = 0.9; // Momentum: fraction of the previous update carried into the next one.
+    float ADAM_BETA1 = 0.9; // Adam: decay of the mean of the gradients.
+    float ADAM_BETA2 = 0.999; // Adam: decay of the mean of the squared gradients.
+    float RMSPROP_DECAY = 0.99; // RMSprop: decay of the mean of the squared gradients.
+    float OPTIMISER_EPSILON = 1e-8; // Adam and RMSprop: keeps the update finite when the gradients are near zero.
+
+    // Prioritized replay parameters
+    bool prioritized_replay = false; // Sample experiences in proportion to their TD error instead of uniformly.
+    float PRIORITY_ALPHA = 0.6; // How strongly priorities skew sampling, 0 is uniform.
+    float PRIORITY_EPSILON = 0.01; // Added to |TD error| so that no experience has zero priority.
+    float PRIORITY_BETA_START = 0.4; // Initial importance sampling correction, annealed to 1.
+    int PRIORITY_BETA_STEPS = 100000; // Number of training steps over which beta reaches 1.
 
     // Q Learning parameters
     float gamma = 0.95; // Balance between focus on immediate and future rewards.
     const int TARGET_UPDATE = 200; // number of training iterations of policy network until target network can be updated.
+    float TARGET_TAU = 0; // Soft target updates: move the target network this fraction towards the policy network on each update, 0 to copy it. Usually small, e.g. 0.005, with TARGET_UPDATE = 1.
 
     // Reward parameters
     float food_reward = 100.0;
@@ -41,8 +61,23 @@ struct NetworkParams {
     // Train/Test parameters
     bool human_guidance_mode = false; // Determines whether to use human to gather data.
     bool train_mode = true;
+    bool headless_mode = false; // Train without opening a window or capping the frame rate.
+    int HEADLESS_MAX_STEPS = 1000000; // Number of environment steps to run in headless mode, 0 for no limit.
+    int HEADLESS_MAX_EPISODES = 0; // Number of games (terminal states) to run in headless mode, 0 for no limit.
+    int NUM_ENVIRONMENTS = 1; // Number of games stepped in lockstep in headless mode, each step collects one experience per game.
+    int NUM_ACTORS = 0; // Headless mode: threads stepping NUM_ENVIRONMENTS games each while the main thread trains, 0 to step and train on one thread.
+    int WEIGHT_PUBLISH_INTERVAL = 50; // Training steps between publishing the policy weights to the actor threads.
+    int TRANSITION_QUEUE_CAPACITY = 4096; // Number of transitions the actor threads can run ahead of training, rounded up to a power of two.
+    float REPLAY_RATIO = 1.0f; // Training steps per transition from the actor threads, the actors wait for the learner to keep to it. 0 to train continuously on whatever arrives.
+    std::string checkpoint_filepath = "best_checkpoint.bin"; // Binary checkpoint for test mode, see checkpoint.h. The text files below are used if it does not exist.
     std::string weights_filepath = "best_weights_two.txt";
     std::string biases_filepath = "best_biases_two.txt";
+    LogLevel LOG_LEVEL = LOG_LEVEL_INFO; // Least severe messages written, those below LOG_COMPILE_LEVEL are compiled out anyway, see logger.h.
+    int ACTION_SUMMARY_INTERVAL = 10000; // Actions between the logged summaries of greedy and random actions and epsilon, 0 for none.
+    std::string trace_filepath = "training_trace.bin"; // Binary trace of the training steps, decode with tools/trace_decoder.
+    int TRACE_INTERVAL = 1; // Steps between trace records, 0 to turn the trace off.
+    int TRACE_BUFFER_CAPACITY = 4096; // Trace records buffered for the writer thread, records are dropped rather than wait if it falls this far behind.
+    std::string profile_filepath = "profile.json"; // Per phase timings written after training, only when built with -DENABLE_PROFILING, see profiler.h.
 };
 
 #endif
\ No newline at end of file
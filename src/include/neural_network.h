@@ -2,39 +2,63 @@
 #define NEURALNETWORK_H
 
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
 #include "../include/layer.h"
+#include "../include/optimiser.h"
 
 class NeuralNetwork {
 public:
-    struct AdamOptimiser {
-        float lr;
-        float beta1;
-        float beta2;
-        float epsilon;
-        float m_weight;
-        float m_bias;
-        float v_weight;
-        float v_bias;
-        int t;
-
-        AdamOptimiser (float learning_rate, float b1, float b2, float eps)
-            : lr(learning_rate), beta1(b1), beta2(b2), epsilon(eps) {}
+    // Scratch memory for infer, so that inference never writes to the network. The workspace is
+    // sized for one network shape and a maximum batch size. Each thread evaluating a network needs
+    // its own workspace, the network itself can be shared.
+    struct Workspace {
+        std::vector<float> buffer_a; // max_batch_size x widest layer, the activations alternate
+        std::vector<float> buffer_b; // between the two buffers layer by layer.
+        int max_batch_size;
 
+        Workspace() : max_batch_size(0) {}
+        Workspace(const NeuralNetwork& network, int max_batch_size);
     };
     
     
+    // The weights and biases of every layer, layer after layer, in one cache line aligned buffer.
+    // The layers only hold views into it, so copying or blending the parameters of two networks is
+    // one pass over one buffer.
+    AlignedVector parameters;
+    // Set when the layers view parameters held elsewhere instead, a memory mapped checkpoint, see
+    // checkpoint.h. Such a network is for inference only and parameters is empty.
+    float* mapped_parameters;
     std::vector<Layer> layers;
-    float learning_rate;
+    Optimiser optimiser;
 
     NeuralNetwork(float learning_rate);
+    NeuralNetwork(const NeuralNetwork& other);
+    NeuralNetwork(NeuralNetwork&& other) = default;
+    NeuralNetwork& operator=(const NeuralNetwork& other);
+    NeuralNetwork& operator=(NeuralNetwork&& other) = default;
 
-    void add_layer(int input_size, int output_size);
+    void add_layer(int input_size, int output_size, Rng& rng = threadRng());
     std::vector<float> forward(const std::vector<float>& input);
+    const float* infer(const float* input, Workspace& workspace) const;
+    const float* infer_batch(const float* input, int batch_size, Workspace& workspace) const;
+    int max_output_size() const;
+    float* parameter_data();
+    const float* parameter_data() const;
+    size_t parameter_count() const;
+    void map_parameters(float* data);
+    bool same_shape(const NeuralNetwork& other) const;
+    void copy_parameters(const NeuralNetwork& source);
+    void soft_update(const NeuralNetwork& source, float tau);
     void backward(const std::vector<float>&grad);
+    const std::vector<float>& forward_batch(const std::vector<float>& input, int batch_size);
+    void backward_batch(const std::vector<float>& grad, int batch_size);
     void load_in_network_params(std::vector<std::vector<std::vector<float>>>& loaded_weights, std::vector<std::vector<float>>& loaded_biases);
-    
+
+private:
+    void bind_layers();
+    void require_owned_parameters(const char* operation) const;
 };
 
 #endif
\ No newline at end of file
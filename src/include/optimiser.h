@@ -0,0 +1,30 @@
+#ifndef OPTIMISER_H
+#define OPTIMISER_H
+
+enum OptimiserType { OPTIMISER_SGD, OPTIMISER_MOMENTUM, OPTIMISER_RMSPROP, OPTIMISER_ADAM };
+
+// The update rule which applies the gradients to the parameters after back propagation. Holds the
+// hyperparameters and the step count, the per-parameter moments are stored by each layer next to
+// the parameters they belong to, see Layer::apply_gradients.
+class Optimiser {
+public:
+    OptimiserType type;
+    float learning_rate;
+    float momentum;     // Momentum: fraction of the previous update carried into the next one.
+    float beta1;        // Adam: decay of the first moment (mean of the gradients).
+    float beta2;        // Adam: decay of the second moment (mean of the squared gradients).
+    float decay;        // RMSprop: decay of the mean of the squared gradients.
+    float epsilon;      // Adam and RMSprop: keeps the division away from zero.
+    int t;              // Number of steps taken.
+    float step_size;    // Adam: learning rate with the bias correction of step t folded in.
+    float step_epsilon; // Adam: epsilon with the bias correction of step t folded in.
+
+    Optimiser(float learning_rate);
+    Optimiser(OptimiserType type, float learning_rate, float momentum, float beta1, float beta2, float decay, float epsilon);
+
+    int moment_count() const;
+    void begin_step();
+    void update(float* parameters, const float* gradients, float* moments, int n) const;
+};
+
+#endif
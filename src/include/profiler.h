@@ -0,0 +1,164 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Hot path instrumentation. Build with -DENABLE_PROFILING to time the phases of a training step
+// and count steps, otherwise every PROFILE_ macro expands to nothing and costs nothing.
+//
+//     PROFILE_SCOPE(PHASE_TRAIN);                  times the rest of the enclosing scope.
+//     PROFILE_BEGIN(timer, PHASE_TRAIN_FORWARD);   times up to PROFILE_END(timer), or the end of
+//     PROFILE_END(timer);                          the scope if that comes first.
+//     PROFILE_COUNT(COUNTER_ENV_STEPS, n);         adds n to a counter.
+//
+// Phases can nest, train contains the train/ phases and environment_step contains snake_update,
+// reward, collisions and encode_state.
+enum ProfilePhase {
+    PHASE_SELECT_ACTION,
+    PHASE_ENVIRONMENT_STEP,
+    PHASE_SNAKE_UPDATE,
+    PHASE_REWARD,
+    PHASE_COLLISIONS,
+    PHASE_ENCODE_STATE,
+    PHASE_STORE_EXPERIENCE,
+    PHASE_TARGET_UPDATE,
+    PHASE_TRAIN,
+    PHASE_TRAIN_SAMPLE,
+    PHASE_TRAIN_FORWARD,
+    PHASE_TRAIN_TARGET_FORWARD,
+    PHASE_TRAIN_BACKWARD,
+    PHASE_TRAIN_PRIORITIES,
+    PHASE_QUEUE_DRAIN,
+    PHASE_PUBLISH_WEIGHTS,
+    PHASE_LOGGING,
+    PHASE_DRAW,
+    PHASE_COUNT
+};
+
+enum ProfileCounter {
+    COUNTER_ENV_STEPS,
+    COUNTER_GRADIENT_STEPS,
+    COUNTER_GAMES,
+    COUNTER_COUNT
+};
+
+extern const char* const PROFILE_PHASE_NAMES[PHASE_COUNT];
+extern const char* const PROFILE_COUNTER_NAMES[COUNTER_COUNT];
+
+// Timestamp in ticks, the time stamp counter on x86, otherwise steady_clock nanoseconds. The
+// profiler measures the tick rate against steady_clock over the run.
+inline uint64_t profileTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Latency histogram with four buckets per power of two of ticks, so any duration is placed to
+// within 25% without knowing the range in advance.
+struct ProfileHistogram {
+    static const int BUCKETS = 256;
+    uint64_t counts[BUCKETS];
+
+    static int bucket(uint64_t ticks) {
+        if (ticks < 4) return (int)ticks;
+        int exponent = 63 - __builtin_clzll(ticks);
+        return (exponent - 1) * 4 + (int)((ticks >> (exponent - 2)) & 3);
+    }
+    static uint64_t lowerBound(int bucket) {
+        if (bucket < 4) return bucket;
+        return (uint64_t)(4 + bucket % 4) << (bucket / 4 - 1);
+    }
+};
+
+struct PhaseStats {
+    uint64_t calls;
+    uint64_t total_ticks;
+    uint64_t max_ticks;
+    ProfileHistogram histogram;
+};
+
+// The statistics of one thread. Each thread records into its own, so recording takes no lock
+// and shares no cache lines, and the report merges them.
+struct ProfileStats {
+    PhaseStats phases[PHASE_COUNT];
+    uint64_t counters[COUNTER_COUNT];
+};
+
+class Profiler {
+public:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileStats>> thread_stats; // Owned here so they outlive their threads.
+    std::chrono::steady_clock::time_point start_time;
+    uint64_t start_ticks;
+
+    Profiler();
+
+    void reset();
+    ProfileStats& threadStats();
+
+    void record(ProfilePhase phase, uint64_t ticks) {
+        PhaseStats& stats = threadStats().phases[phase];
+        stats.calls++;
+        stats.total_ticks += ticks;
+        if (ticks > stats.max_ticks) stats.max_ticks = ticks;
+        stats.histogram.counts[ProfileHistogram::bucket(ticks)]++;
+    }
+    void count(ProfileCounter counter, uint64_t n) { threadStats().counters[counter] += n; }
+
+    ProfileStats merged();
+    void printSummary(std::ostream& out);
+    void writeReport(const std::string& filepath);
+
+private:
+    void elapsed(double& wall_seconds, double& ticks_per_second) const;
+};
+
+Profiler& profiler();
+
+// Times from construction to stop or destruction, whichever comes first.
+class ScopedTimer {
+public:
+    ScopedTimer(ProfilePhase phase) : phase(phase), start(profileTicks()), running(true) {}
+    ~ScopedTimer() { stop(); }
+
+    void stop() {
+        if (running) {
+            profiler().record(phase, profileTicks() - start);
+            running = false;
+        }
+    }
+
+private:
+    ProfilePhase phase;
+    uint64_t start;
+    bool running;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(profile_timer_, __LINE__)(phase)
+#define PROFILE_BEGIN(name, phase) ScopedTimer name(phase)
+#define PROFILE_END(name) name.stop()
+#define PROFILE_COUNT(counter, n) profiler().count(counter, n)
+#else
+#define PROFILE_SCOPE(phase) do {} while (0)
+#define PROFILE_BEGIN(name, phase) do {} while (0)
+#define PROFILE_END(name) do {} while (0)
+#define PROFILE_COUNT(counter, n) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef REWARD_H
+#define REWARD_H
+
+#include <memory>
+
+#include "../include/game.h"
+#include "../include/game_params.h"
+#include "../include/network_params.h"
+
+// The reward of a step which ended neither by eating food nor by a collision. Implementations are
+// built once and called every step, so they must not allocate in reward().
+class RewardShaping {
+public:
+    virtual ~RewardShaping() {}
+    virtual float reward(const Snake &snake, const Food &food, Cell previous_head_position) const = 0;
+};
+
+// Rewards moving closer to the food and penalises moving away, in proportion to the change in
+// straight line distance.
+class DistanceShaping : public RewardShaping {
+public:
+    float move_towards_food_reward;
+
+    DistanceShaping(float move_towards_food_reward);
+
+    float reward(const Snake &snake, const Food &food, Cell previous_head_position) const override;
+};
+
+// The same small penalty every step, to encourage finding food quickly.
+class TimePenaltyShaping : public RewardShaping {
+public:
+    float general_time_penalty;
+
+    TimePenaltyShaping(float general_time_penalty);
+
+    float reward(const Snake &snake, const Food &food, Cell previous_head_position) const override;
+};
+
+class RewardEngine {
+public:
+    float food_reward;
+    float self_collision_penalty;
+    float edge_collision_penalty;
+    int cell_count;
+    std::unique_ptr<RewardShaping> shaping;
+
+    RewardEngine(const NetworkParams &network_params, const GameParams &game_params);
+
+    void setShaping(std::unique_ptr<RewardShaping> shaping);
+    float reward(const Snake &snake, const Food &food, Cell previous_head_position) const;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// Streams of the random number generators. Generators built from the same seed but different
+// streams give independent sequences, so every consumer of randomness has its own stream and
+// drawing more numbers in one never changes the numbers drawn in another.
+enum RngStream : uint64_t {
+    RNG_STREAM_DEFAULT = 0,
+    RNG_STREAM_REPLAY = 1,
+    RNG_STREAM_ACTIONS = 2,
+    RNG_STREAM_FOOD = 3,
+    RNG_STREAM_LAYER_INIT = 4,
+    RNG_STREAM_ACTORS = 1000, // Actor i uses RNG_STREAM_ACTORS + i.
+    RNG_STREAM_THREADS = 1ULL << 32 // The threadRng of the i-th thread to use one.
+};
+
+// PCG32 random number generator: 16 bytes of state, a multiply, an add and a rotate per 32 bits,
+// against the 5KB of std::mt19937. Also a standard uniform random bit generator, so it can be
+// passed to the standard library's distributions and algorithms.
+class Rng {
+public:
+    typedef uint32_t result_type;
+
+    uint64_t state;
+    uint64_t increment; // Odd, selects the stream.
+
+    Rng(uint64_t seed = 0, uint64_t stream = RNG_STREAM_DEFAULT);
+
+    static constexpr uint32_t min() { return 0; }
+    static constexpr uint32_t max() { return UINT32_MAX; }
+    uint32_t operator()() { return next(); }
+
+    uint32_t next() {
+        uint64_t old_state = state;
+        state = old_state * 6364136223846793005ULL + increment;
+        uint32_t xorshifted = (uint32_t)(((old_state >> 18) ^ old_state) >> 27);
+        uint32_t rotation = (uint32_t)(old_state >> 59);
+        return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+    }
+
+    // Uniform integer in [0, bound), bound above zero. Lemire's multiply and shift, which only
+    // divides in the rare case that a draw has to be rejected to stay unbiased.
+    uint32_t below(uint32_t bound) {
+        uint64_t product = (uint64_t)next() * bound;
+        uint32_t low = (uint32_t)product;
+        if (low < bound) {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = (uint64_t)next() * bound;
+                low = (uint32_t)product;
+            }
+        } return (uint32_t)(product >> 32);
+    }
+
+    // Uniform float in [0, 1), from the top 24 bits of one draw.
+    float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+    float uniform(float low, float high) { return low + (high - low) * uniform(); }
+
+    // Uniform double in [0, 1), from 53 bits of two draws.
+    double uniformDouble() {
+        uint64_t high = next();
+        uint64_t low = next();
+        return ((high << 32 | low) >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+uint64_t rngSeed(int seed);
+Rng& threadRng();
+
+#endif
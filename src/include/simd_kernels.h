@@ -0,0 +1,38 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE, SIMD_AVX2, SIMD_AVX512 };
+
+// Table of the vector kernels used by the matrix routines, one table per instruction set.
+struct SimdKernels {
+    SimdLevel level;
+    const char* name;
+
+    // Returns sum(a[i] * b[i]).
+    float (*dot)(const float* a, const float* b, int n);
+    // out[r] = sum(x[i] * a_r[i]) for the four rows a0..a3, sharing every load of x.
+    void (*dot4)(const float* x, const float* a0, const float* a1, const float* a2, const float* a3, int n, float* out);
+    // y[i] += alpha * x[i].
+    void (*axpy)(float alpha, const float* x, float* y, int n);
+    // y[i] = relu(y[i] + bias[i]).
+    void (*bias_relu)(const float* bias, float* y, int n);
+
+    // Fused optimiser updates, each one pass over the gradients, moments and parameters.
+    // m[i] = momentum * m[i] + g[i], then w[i] -= learning_rate * m[i].
+    void (*momentum_update)(float learning_rate, float momentum, const float* g, float* m, float* w, int n);
+    // v[i] = decay * v[i] + (1 - decay) * g[i]^2, then w[i] -= learning_rate * g[i] / (sqrt(v[i]) + epsilon).
+    void (*rmsprop_update)(float learning_rate, float decay, float epsilon, const float* g, float* v, float* w, int n);
+    // m[i] = beta1 * m[i] + (1 - beta1) * g[i], v[i] = beta2 * v[i] + (1 - beta2) * g[i]^2,
+    // then w[i] -= step_size * m[i] / (sqrt(v[i]) + epsilon).
+    void (*adam_update)(float step_size, float beta1, float beta2, float epsilon, const float* g, float* m, float* v, float* w, int n);
+
+    // y[i] = (1 - t) * y[i] + t * x[i], moves y a fraction t of the way towards x.
+    void (*lerp)(float t, const float* x, float* y, int n);
+};
+
+SimdLevel detectSimdLevel();
+const SimdKernels* simdKernelsFor(SimdLevel level);
+const SimdKernels& simdKernels();
+void setSimdLevel(SimdLevel level);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SNAKE_BODY_H
+#define SNAKE_BODY_H
+
+#include <cstdint>
+
+#include "../include/bitboard.h"
+
+// Integer grid coordinates of a cell. Also used for directions, with components -1, 0 or 1.
+struct Cell {
+    int16_t x;
+    int16_t y;
+};
+
+inline bool operator==(Cell a, Cell b) { return a.x == b.x && a.y == b.y; }
+inline bool operator!=(Cell a, Cell b) { return !(a == b); }
+
+// Fixed capacity ring buffer of the snake's segments, head first. A snake can cover every cell of
+// the largest board plus its head moving onto a covered cell, hence the capacity. Pushing and
+// popping never allocates, and copying the body is a flat copy of the array.
+class SnakeBody {
+public:
+    static const int CAPACITY = MAX_CELL_COUNT * MAX_CELL_COUNT + 1;
+
+    Cell cells[CAPACITY];
+    int start;
+    int length;
+
+    SnakeBody() : cells(), start(0), length(0) {}
+
+    int size() const { return length; }
+    Cell operator[](int i) const { return cells[wrap(start + i)]; }
+    Cell front() const { return cells[start]; }
+    Cell back() const { return cells[wrap(start + length - 1)]; }
+
+    void pushFront(Cell cell) {
+        start = start == 0 ? CAPACITY - 1 : start - 1;
+        cells[start] = cell;
+        length++;
+    }
+    void pushBack(Cell cell) {
+        cells[wrap(start + length)] = cell;
+        length++;
+    }
+    void popBack() { length--; }
+    void clear() {
+        start = 0;
+        length = 0;
+    }
+
+private:
+    static int wrap(int index) { return index >= CAPACITY ? index - CAPACITY : index; }
+};
+
+#endif
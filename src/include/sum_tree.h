@@ -0,0 +1,22 @@
+#ifndef SUM_TREE_H
+#define SUM_TREE_H
+
+#include <cstddef>
+#include <vector>
+
+// Binary tree where every node holds the sum of its children, and the leaves hold the priorities.
+class SumTree {
+public:
+    std::vector<double> nodes; // nodes[1] is the root, the leaves are nodes[leaf_count + i].
+    size_t leaf_count;
+
+    SumTree(size_t capacity);
+
+    double total() const { return nodes[1]; }
+    double get(size_t index) const { return nodes[leaf_count + index]; }
+
+    void update(size_t index, double priority);
+    size_t find(double value) const;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/environment.h"
+
+// Binary training trace. The file is a TraceHeader followed by fixed size TraceRecords, one per
+// sampled training step, in step order. tools/trace_decoder.cpp turns it into CSV or text.
+const char TRACE_MAGIC[8] = {'S', 'N', 'A', 'K', 'E', 'T', 'R', 'C'};
+const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t action_size;
+    uint32_t interval;      // Steps between records.
+    uint64_t record_count;  // Filled in when the trace is closed, zero if the run did not finish.
+    uint64_t dropped_count; // Records lost because the buffer was full.
+};
+
+// One training step, a cache line long.
+struct TraceRecord {
+    uint64_t step;
+    float reward;
+    int32_t action;
+    int16_t head_x;
+    int16_t head_y;
+    int16_t food_x;
+    int16_t food_y;
+    float q_values[ACTION_SIZE];       // Q values of the state before the training step.
+    float q_values_after[ACTION_SIZE]; // And after it.
+    uint8_t done;
+    uint8_t padding[7];
+};
+
+static_assert(sizeof(TraceRecord) == 64, "TraceRecord should fill one cache line");
+
+// Records training steps into a preallocated ring which a background thread writes to the trace
+// file. The training thread only copies a record into the ring, it never waits on the file, and
+// if the writer falls a whole ring behind records are dropped and counted rather than blocking
+// training. One thread records, the writer thread is the only other user of the ring.
+class TraceWriter {
+public:
+    std::unique_ptr<TraceRecord[]> records;
+    size_t capacity; // Power of two.
+    size_t mask;
+    int interval;    // Record every interval-th step, 0 turns tracing off.
+    uint64_t dropped;
+    uint64_t written;
+
+    // The recording and writer positions on separate cache lines.
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+
+    TraceWriter(const std::string& filepath, size_t capacity, int interval);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool sampled(long step) const { return interval > 0 && step % interval == 0; }
+    bool record(const TraceRecord& record);
+    void close();
+
+private:
+    std::ofstream file;
+    std::thread writer;
+    std::atomic<bool> stop;
+
+    void writerLoop();
+    size_t flush();
+};
+
+std::vector<TraceRecord> readTrace(const std::string& filepath, TraceHeader& header);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TRANSITION_QUEUE_H
+#define TRANSITION_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "../include/environment.h"
+
+// One step of one game, as sent from an actor to the learner. Fixed size so that the queue
+// never allocates per transition.
+struct Transition {
+    float state[STATE_SIZE];
+    float next_state[STATE_SIZE];
+    float reward;
+    int action;
+    uint8_t done;
+};
+
+// Bounded lock-free ring of transitions, any number of threads push and one thread drains.
+// Every slot carries a sequence number which says whose turn it is: a producer claims a position
+// with one compare and swap on tail, writes the transition and publishes it by setting the slot's
+// sequence to position + 1, the consumer reads it and hands the slot back to the producers of
+// the next lap by setting the sequence to position + capacity. Nothing ever takes a lock.
+class TransitionQueue {
+public:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Transition transition;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity; // Power of two.
+    size_t mask;
+
+    // Producer and consumer positions on separate cache lines, so that pushes and drains do not
+    // invalidate each other's line.
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) size_t head;
+
+    TransitionQueue(size_t capacity);
+
+    bool tryPush(const Transition& transition);
+    size_t size() const;
+
+    // Pass up to max_count queued transitions to consume, oldest first, and free their slots.
+    // Only the consumer thread may call this. Returns the number consumed.
+    template <typename Consumer>
+    size_t drain(Consumer consume, size_t max_count) {
+        size_t count = 0;
+        while (count < max_count) {
+            Slot& slot = slots[head & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != head + 1) break;
+            consume(slot.transition);
+            slot.sequence.store(head + capacity, std::memory_order_release);
+            head++;
+            count++;
+        } return count;
+    }
+};
+
+#endif
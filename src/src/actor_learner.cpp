@@ -0,0 +1,403 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "../include/actor_learner.h"
+#include "../include/profiler.h"
+#include "../include/rng.h"
+
+/*
+    Class: PolicyPublisher
+
+    Component: Constructor
+
+    Name: PolicyPublisher
+
+    Description: Start with a copy of the policy network as version zero.
+
+    Arguments:
+        (NeuralNetwork) policy: The learner's policy network.
+
+    Returns:
+        None
+*/
+PolicyPublisher::PolicyPublisher(const NeuralNetwork& policy)
+    : network(policy)
+    , version(0)
+{}
+
+/*
+    Class: PolicyPublisher
+
+    Component: Method
+
+    Name: publish
+
+    Description: Copy the learner's current policy parameters and bump the version so that the
+        actors pick them up. Called by the learner thread.
+
+    Arguments:
+        (NeuralNetwork) policy: The learner's policy network.
+
+    Returns:
+        None
+*/
+void PolicyPublisher::publish(const NeuralNetwork& policy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    network.copy_parameters(policy);
+    version.fetch_add(1, std::memory_order_release);
+}
+
+/*
+    Class: PolicyPublisher
+
+    Component: Method
+
+    Name: fetch
+
+    Description: Copy the published parameters into an actor's network if they are newer than
+        the ones it has. Called by the actor threads before every step.
+
+    Arguments:
+        (NeuralNetwork) local: The actor's network.
+        (int) local_version: The version the actor's network holds, updated on a copy.
+
+    Returns:
+        (bool) True if the parameters were copied.
+
+    Code Explanation:
+
+    Code:
+
+    if (version.load(std::memory_order_acquire) == local_version) {
+        return false;
+    }
+
+    Explanation:
+
+    Most steps there is nothing new, checking the version first keeps the actors from taking the
+    lock every step.
+*/
+bool PolicyPublisher::fetch(NeuralNetwork& local, int& local_version) {
+    if (version.load(std::memory_order_acquire) == local_version) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    local.copy_parameters(network);
+    local_version = version.load(std::memory_order_relaxed);
+    return true;
+}
+
+/*
+    Class: ActorLearner
+
+    Component: Constructor
+
+    Name: ActorLearner
+
+    Description: Set up the queue and the published policy for a run. No threads are started
+        until run is called.
+
+    Arguments:
+        (DQN) dqn: The agent to train, its replay memory and networks are only touched by the
+            thread calling run.
+        (GameParams) game_params: The game parameters for every actor's games.
+        (NetworkParams) params: The training parameters, see NUM_ACTORS, WEIGHT_PUBLISH_INTERVAL,
+            TRANSITION_QUEUE_CAPACITY and REPLAY_RATIO.
+
+    Returns:
+        None
+*/
+ActorLearner::ActorLearner(DQN& dqn, const GameParams& game_params, const NetworkParams& params)
+    : dqn(dqn)
+    , game_params(game_params)
+    , params(params)
+    , queue(params.TRANSITION_QUEUE_CAPACITY)
+    , publisher(dqn.policy_net)
+    , stop(false)
+    , actor_steps(0)
+    , steps(0)
+    , games_played(0)
+    , train_steps(0)
+{
+    if (params.NUM_ACTORS <= 0) {
+        throw std::runtime_error("ActorLearner needs at least one actor");
+    }
+}
+
+/*
+    Class: ActorLearner
+
+    Component: Method
+
+    Name: run
+
+    Description: Train until the headless step or game budget is used up. Starts NUM_ACTORS actor
+        threads and runs the learner on the calling thread, then stops and joins the actors.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    max_count = std::min(max_count, (size_t)params.SAMPLING_THRESHOLD - dqn.replay_memory.size);
+
+    Explanation:
+
+    Until the replay memory reaches the sampling threshold train does nothing, so the learner
+    only moves transitions from the queue into the replay memory, yielding its time to the
+    actors when the queue is empty. The drain stops exactly at the threshold, so that every
+    transition after it is paid for by training.
+
+    Code:
+
+    max_count = train_credit >= 1 ? 0 : (size_t)std::ceil((1 - train_credit) / params.REPLAY_RATIO);
+
+    Explanation:
+
+    Past the threshold every received transition earns REPLAY_RATIO training steps, and the
+    learner takes no more transitions than it needs for its next step. Everything else stays in
+    the queue, which fills up while the learner trains, and a full queue makes the actors wait,
+    see actorLoop. So the actors run only as far ahead of training as the queue allows and
+    REPLAY_RATIO is the ratio of training steps to transitions actually achieved, whatever the
+    relative speed of the actors and the learner. With REPLAY_RATIO 0 the two are not coupled:
+    the learner drains whatever has arrived and trains continuously.
+
+    Code:
+
+    size_t count = queue.drain(store, max_count);
+
+    Explanation:
+
+    Move the transitions straight from the queue slots into the replay memory, also stopping at
+    the step budget. The game budget can run out part way through a drain, so store checks the
+    budget itself and discards the rest of the drain once it is used up, the run ends straight
+    after.
+
+    Code:
+
+    if (train_steps % params.TARGET_UPDATE == 0) {
+        dqn.updateTargetNet();
+    }
+
+    Explanation:
+
+    The target network and the published weights are both refreshed by learner step count, the
+    same way the single thread loop updates the target network by iteration.
+*/
+void ActorLearner::run() {
+    std::vector<std::thread> actors;
+    for (int actor = 0; actor < params.NUM_ACTORS; actor++) {
+        actors.emplace_back(&ActorLearner::actorLoop, this, actor);
+    }
+
+    auto store = [this](const Transition& transition) {
+        if (!budgetRemaining()) {
+            return;
+        }
+        dqn.replay_memory.storeExperience(transition.state, transition.action, transition.reward,
+                                          transition.next_state, transition.done);
+        steps++;
+        if (transition.done) {
+            games_played++;
+        }
+    };
+
+    double train_credit = 0; // Training steps allowed by REPLAY_RATIO and not yet taken.
+    while (budgetRemaining()) {
+        bool sampling = dqn.replay_memory.size >= (size_t)params.SAMPLING_THRESHOLD;
+        size_t max_count = queue.capacity;
+        if (!sampling) {
+            max_count = std::min(max_count, (size_t)params.SAMPLING_THRESHOLD - dqn.replay_memory.size);
+        } else if (params.REPLAY_RATIO > 0) {
+            max_count = train_credit >= 1 ? 0 : (size_t)std::ceil((1 - train_credit) / params.REPLAY_RATIO);
+        }
+        if (params.HEADLESS_MAX_STEPS > 0) {
+            max_count = std::min(max_count, (size_t)(params.HEADLESS_MAX_STEPS - steps));
+        }
+        PROFILE_BEGIN(drain_timer, PHASE_QUEUE_DRAIN);
+        size_t count = queue.drain(store, max_count);
+        PROFILE_END(drain_timer);
+
+        if (!sampling) {
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        if (params.REPLAY_RATIO > 0) {
+            train_credit += count * params.REPLAY_RATIO;
+            if (train_credit < 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            train_credit -= 1;
+        }
+
+        if (train_steps % params.TARGET_UPDATE == 0) {
+            PROFILE_SCOPE(PHASE_TARGET_UPDATE);
+            dqn.updateTargetNet();
+        }
+        dqn.train(params.BATCH_SIZE);
+        train_steps++;
+
+        if (train_steps % params.WEIGHT_PUBLISH_INTERVAL == 0) {
+            PROFILE_SCOPE(PHASE_PUBLISH_WEIGHTS);
+            publisher.publish(dqn.policy_net);
+        }
+    }
+
+    stop.store(true);
+    for (auto& actor : actors) {
+        actor.join();
+    }
+}
+
+/*
+    Class: ActorLearner
+
+    Component: Method
+
+    Name: budgetRemaining
+
+    Description: Check the headless step and game limits, a limit of zero means no limit.
+
+    Arguments:
+        None
+
+    Returns:
+        (bool) True while training should continue.
+*/
+bool ActorLearner::budgetRemaining() const {
+    if (params.HEADLESS_MAX_STEPS > 0 && steps >= params.HEADLESS_MAX_STEPS) return false;
+    if (params.HEADLESS_MAX_EPISODES > 0 && games_played >= params.HEADLESS_MAX_EPISODES) return false;
+    return true;
+}
+
+/*
+    Class: ActorLearner
+
+    Component: Method
+
+    Name: epsilon
+
+    Description: The probability of a random action at a step, following the same schedule as
+        DQN::selectActionTrain: always random before the minimum exploration threshold, then
+        decaying from EPSILON_START towards EPSILON_END.
+
+    Arguments:
+        (long) step: The number of steps taken by all actors so far.
+
+    Returns:
+        (float) The exploration probability.
+*/
+float ActorLearner::epsilon(long step) const {
+    if (step < params.MINIMUM_EXPLORATION_THRESHOLD) {
+        return 1.0f;
+    }
+
+    long steps_done = params.steps_done + step - params.MINIMUM_EXPLORATION_THRESHOLD;
+    return params.EPSILON_END + (params.EPSILON_START - params.EPSILON_END) * exp(-1.0 * steps_done / params.EPSILON_DECAY);
+}
+
+/*
+    Class: ActorLearner
+
+    Component: Method
+
+    Name: actorLoop
+
+    Description: The body of one actor thread. Steps NUM_ENVIRONMENTS games in lockstep with
+        epsilon greedy actions from a local copy of the policy, and pushes one transition per
+        game per step to the learner, until the learner stops the run.
+
+    Arguments:
+        (int) actor: The actor index, used to give every actor different seeds.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    const float* q_values = policy.infer_batch(environment.states.data(), environment.num_envs, workspace);
+
+    Explanation:
+
+    The states matrix of the actor's games is already a batch, so one inference call gives the
+    Q values of every game. The actor owns its network and workspace, nothing is shared with the
+    learner except the queue and the publisher.
+
+    Code:
+
+    while (!queue.tryPush(transition)) {
+
+    Explanation:
+
+    A full queue means the learner is behind. Sleep rather than spin, a spinning actor would take
+    the processor time the learner needs to catch up, and stop if the run is over.
+*/
+void ActorLearner::actorLoop(int actor) {
+    GameParams actor_game_params = game_params;
+    if (game_params.random_seed >= 0) {
+        actor_game_params.random_seed = game_params.random_seed + actor * params.NUM_ENVIRONMENTS;
+    }
+    VectorEnvironment environment(params.NUM_ENVIRONMENTS, actor_game_params, params);
+    std::vector<int> actions(environment.num_envs);
+
+    NeuralNetwork policy(params.LEARNING_RATE);
+    int version;
+    {
+        std::lock_guard<std::mutex> lock(publisher.mutex);
+        policy = publisher.network;
+        version = publisher.version.load();
+    }
+    NeuralNetwork::Workspace workspace(policy, environment.num_envs);
+    int action_size = policy.layers.back().output_size;
+
+    Rng generator(rngSeed(params.RANDOM_SEED), RNG_STREAM_ACTORS + actor);
+
+    Transition transition;
+    while (!stop.load(std::memory_order_relaxed)) {
+        publisher.fetch(policy, version);
+
+        PROFILE_BEGIN(select_timer, PHASE_SELECT_ACTION);
+        long step = actor_steps.fetch_add(environment.num_envs, std::memory_order_relaxed);
+        float threshold = epsilon(step);
+        const float* q_values = nullptr;
+        if (step >= params.MINIMUM_EXPLORATION_THRESHOLD) {
+            q_values = policy.infer_batch(environment.states.data(), environment.num_envs, workspace);
+        }
+
+        for (int i = 0; i < environment.num_envs; i++) {
+            if (q_values != nullptr && generator.uniform() > threshold) {
+                const float* q = q_values + i * action_size;
+                actions[i] = std::max_element(q, q + action_size) - q;
+            } else {
+                actions[i] = generator.below(action_size);
+            }
+        }
+        PROFILE_END(select_timer);
+
+        environment.step(actions);
+
+        for (int i = 0; i < environment.num_envs; i++) {
+            std::copy(environment.previousState(i), environment.previousState(i) + STATE_SIZE, transition.state);
+            std::copy(environment.state(i), environment.state(i) + STATE_SIZE, transition.next_state);
+            transition.action = actions[i];
+            transition.reward = environment.rewards[i];
+            transition.done = environment.dones[i];
+            while (!queue.tryPush(transition)) {
+                if (stop.load(std::memory_order_relaxed)) return;
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    }
+}
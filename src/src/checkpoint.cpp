@@ -0,0 +1,330 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../include/checkpoint.h"
+
+/*
+    Function: checkpointChecksum
+
+    Description: 64 bit FNV-1a hash of a block of memory, used to detect a corrupt or truncated
+        checkpoint payload.
+
+    Arguments:
+        (const void*) data: The start of the block.
+        (size_t) size: The number of bytes.
+
+    Returns:
+        (uint64_t) The hash.
+*/
+uint64_t checkpointChecksum(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    } return hash;
+}
+
+/*
+    Function: saveCheckpoint
+
+    Description: Write the parameters of a network to a binary checkpoint, see checkpoint.h for
+        the layout. The floats are written as their raw bytes, so loading gives back exactly the
+        same values.
+
+    Arguments:
+        (std::string) filepath: The file to write, replaced if it exists.
+        (NeuralNetwork) network: The network to save.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    header.payload_offset = (header_bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+
+    Explanation:
+
+    A memory mapping starts on a page boundary, so a payload at a multiple of MATRIX_ALIGNMENT in
+    the file is at a multiple of MATRIX_ALIGNMENT in memory, as the layers' kernels expect.
+*/
+void saveCheckpoint(const std::string& filepath, const NeuralNetwork& network) {
+    std::vector<CheckpointLayer> shapes;
+    for (const auto& layer : network.layers) {
+        shapes.push_back({(uint32_t)layer.input_size, (uint32_t)layer.output_size});
+    }
+
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.byte_order = CHECKPOINT_BYTE_ORDER;
+    header.dtype = CHECKPOINT_FLOAT32;
+    header.alignment = MATRIX_ALIGNMENT;
+    header.layer_count = shapes.size();
+
+    size_t header_bytes = sizeof(header) + shapes.size() * sizeof(CheckpointLayer);
+    header.payload_offset = (header_bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+    header.payload_size = network.parameter_count() * sizeof(float);
+    header.checksum = checkpointChecksum(network.parameter_data(), header.payload_size);
+
+    std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Could not open checkpoint file for writing: " + filepath);
+    }
+
+    std::vector<char> padding(header.payload_offset - header_bytes, 0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(shapes.data()), shapes.size() * sizeof(CheckpointLayer));
+    file.write(padding.data(), padding.size());
+    file.write(reinterpret_cast<const char*>(network.parameter_data()), header.payload_size);
+
+    if (!file) {
+        throw std::runtime_error("Could not write checkpoint file: " + filepath);
+    }
+}
+
+/*
+    Function: loadCheckpoint
+
+    Description: Copy the parameters of a checkpoint into a network with the same layer sizes,
+        for example to carry on training from it. For inference only, use MappedCheckpoint and
+        evaluate its network in place instead.
+
+    Arguments:
+        (std::string) filepath: The checkpoint file.
+        (NeuralNetwork) network: The network to load into.
+
+    Returns:
+        None
+*/
+void loadCheckpoint(const std::string& filepath, NeuralNetwork& network) {
+    MappedCheckpoint checkpoint(filepath);
+    if (!network.same_shape(checkpoint.network)) {
+        throw std::runtime_error("Mismatch in layer sizes between the network and checkpoint: " + filepath);
+    }
+    network.copy_parameters(checkpoint.network);
+}
+
+/*
+    Class: MappedCheckpoint
+
+    Component: Constructor
+
+    Name: MappedCheckpoint
+
+    Description: Map a checkpoint file, check it and set up a network which uses the mapped
+        parameters in place. Nothing is parsed or copied, so the cost is the mapping, the
+        checksum and setting up the layers, whatever the size of the network.
+
+    Arguments:
+        (std::string) filepath: The checkpoint file.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    network.map_parameters(reinterpret_cast<float*>(static_cast<char*>(data) + header->payload_offset));
+
+    Explanation:
+
+    The network's layers are created with the checkpoint's layer sizes but no parameters of their
+    own, then pointed at the payload. Nothing is initialised only to be thrown away.
+*/
+MappedCheckpoint::MappedCheckpoint(const std::string& filepath)
+    : header(nullptr)
+    , layer_shapes(nullptr)
+    , network(0.0f)
+    , data(nullptr)
+    , size(0)
+    , file_handle(nullptr)
+    , mapping_handle(nullptr)
+{
+    map(filepath);
+    try {
+        validate(filepath);
+        header = static_cast<const CheckpointHeader*>(data);
+        layer_shapes = reinterpret_cast<const CheckpointLayer*>(header + 1);
+
+        for (uint32_t i = 0; i < header->layer_count; i++) {
+            network.layers.emplace_back(layer_shapes[i].input_size, layer_shapes[i].output_size);
+        }
+        network.map_parameters(reinterpret_cast<float*>(static_cast<char*>(data) + header->payload_offset));
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+/*
+    Class: MappedCheckpoint
+
+    Component: Destructor
+
+    Name: ~MappedCheckpoint
+
+    Description: Unmap the file. The network, and any copy of it, must not be used afterwards.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+MappedCheckpoint::~MappedCheckpoint() {
+    unmap();
+}
+
+/*
+    Class: MappedCheckpoint
+
+    Component: Method
+
+    Name: map
+
+    Description: Map the whole file into memory, copy on write, so that the network's views can
+        be non const without any write ever reaching the file.
+
+    Arguments:
+        (std::string) filepath: The checkpoint file.
+
+    Returns:
+        None
+*/
+void MappedCheckpoint::map(const std::string& filepath) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open checkpoint file: " + filepath);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Checkpoint file is empty or unreadable: " + filepath);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mapping != nullptr) CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Could not map checkpoint file: " + filepath);
+    }
+    file_handle = file;
+    mapping_handle = mapping;
+    data = view;
+    size = file_size.QuadPart;
+#else
+    int file = open(filepath.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("Could not open checkpoint file: " + filepath);
+    }
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(file);
+        throw std::runtime_error("Checkpoint file is empty or unreadable: " + filepath);
+    }
+    void* view = mmap(nullptr, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("Could not map checkpoint file: " + filepath);
+    }
+    data = view;
+    size = file_stat.st_size;
+#endif
+}
+
+/*
+    Class: MappedCheckpoint
+
+    Component: Method
+
+    Name: unmap
+
+    Description: Release the mapping, safe to call more than once.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+void MappedCheckpoint::unmap() {
+    if (data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    munmap(data, size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+/*
+    Class: MappedCheckpoint
+
+    Component: Method
+
+    Name: validate
+
+    Description: Check the mapped file is a checkpoint this build can use in place: the magic,
+        byte order, version, dtype and alignment, that the layer shapes and payload fit in the
+        file and agree with each other, and the payload checksum.
+
+    Arguments:
+        (std::string) filepath: The checkpoint file, for the error messages.
+
+    Returns:
+        None
+*/
+void MappedCheckpoint::validate(const std::string& filepath) const {
+    auto fail = [&](const std::string& reason) {
+        throw std::runtime_error("Invalid checkpoint " + filepath + ": " + reason);
+    };
+
+    if (size < sizeof(CheckpointHeader)) fail("file too small for the header");
+    const CheckpointHeader* file_header = static_cast<const CheckpointHeader*>(data);
+    if (std::memcmp(file_header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) fail("not a checkpoint file");
+    if (file_header->byte_order != CHECKPOINT_BYTE_ORDER) fail("written with a different byte order");
+    if (file_header->version != CHECKPOINT_VERSION) fail("unsupported version " + std::to_string(file_header->version));
+    if (file_header->dtype != CHECKPOINT_FLOAT32) fail("unsupported dtype " + std::to_string(file_header->dtype));
+    if (file_header->alignment != MATRIX_ALIGNMENT) fail("payload padded for a different alignment");
+    if (file_header->layer_count == 0) fail("no layers");
+
+    size_t header_bytes = sizeof(CheckpointHeader) + (size_t)file_header->layer_count * sizeof(CheckpointLayer);
+    if (header_bytes > size) fail("file too small for the layer shapes");
+    if (file_header->payload_offset % MATRIX_ALIGNMENT != 0 || file_header->payload_offset < header_bytes) fail("misplaced payload");
+    if (file_header->payload_offset > size || file_header->payload_size > size - file_header->payload_offset) fail("truncated payload");
+
+    const CheckpointLayer* shapes = reinterpret_cast<const CheckpointLayer*>(file_header + 1);
+    uint64_t expected_size = 0;
+    for (uint32_t i = 0; i < file_header->layer_count; i++) {
+        if (shapes[i].input_size == 0 || shapes[i].output_size == 0) fail("empty layer");
+        expected_size += Layer::parameter_count(shapes[i].input_size, shapes[i].output_size) * sizeof(float);
+    }
+    if (expected_size != file_header->payload_size) fail("payload size does not match the layer shapes");
+
+    const char* payload = static_cast<const char*>(data) + file_header->payload_offset;
+    if (checkpointChecksum(payload, file_header->payload_size) != file_header->checksum) fail("checksum mismatch");
+}
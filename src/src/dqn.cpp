@@ -1,132 +1,23 @@
 #include <iostream>
 #include <algorithm>
-#include <random>
+#include <cmath>
+#include <stdexcept>
 
 #include "../include/dqn.h"
 #include "../include/game.h"
 #include "../include/game_params.h"
+#include "../include/logger.h"
 #include "../include/network_params.h"
-
-/*
-    Function: getReward
-
-    Description: Get the reward.
-
-    Arguments:
-        (Snake) snake: The snake object.
-        (Food) food: The food object.
-     
-    Returns:
-        (float) A reward. See the training_params.h header file for the values.
-            Positive rewards will encourage snake to win, whilst negative rewards,
-            will discourage snake from behaviours that will cause it to lose.
-
-    Code explanation:
-
-    Code:
-
-    GameParams game_params; 
-    NetworkParams training_params;
-
-    float food_reward = training_params.food_reward;
-    float self_collision_penalty = training_params.self_collision_penalty;
-    float edge_collision_penalty = training_params.edge_collision_penalty;
-    float general_time_penalty = training_params.general_time_penalty;
-    float cell_count = game_params.cell_count
-
-    Explanation:
-
-    Initialise parameters. Retrieve relevant reward parameters.
-
-    Code:
-
-    std::deque<Vector2> headless_body = snake.body;
-    headless_body.pop_front();
-
-    Explanation:
-
-    Set up headless body for tail collision penalty.
-
-    Code:
-
-    if (Vector2Equals(snake.body[0], food.position)) return food_reward;
-
-    Explanation:
-
-    If snake head is same position as good, hence eats a food, return the
-    food reward.
-
-    Code:
-
-    if (elementInDeque(snake.body[0], snake.body)) return self_collision_penalty;
-
-    Explanation:
-
-    If snake head is same position as part of its body, hence it has collided, 
-    with itself return self collision penalty.
-
-    Code:
-
-    if (snake.body[0].x < 0 || snake.body[0].x >= cell_count || snake.body[0].y < 0 || snake.body[0].y >= cell_count) return edge_collision_penalty;
-
-    Explanation:
-
-    If snake head is past one of the borders of the game, vertical or horizontal, 
-    return edge collision penalty.
-
-    Code:
-
-    return general_time_penalty;
-
-    Explanation:
-
-    Return general time penalty to encourage snake to find food in fast as time
-    possible.
-
-*/ 
-float getReward(const Snake &snake, const Food &food, const Vector2 &previous_head_position) {
-    GameParams game_params; 
-    NetworkParams training_params;
-
-    float food_reward = training_params.food_reward;
-    float self_collision_penalty = training_params.self_collision_penalty;
-    float edge_collision_penalty = training_params.edge_collision_penalty;
-    float general_time_penalty = training_params.general_time_penalty;
-    float move_towards_food_reward = training_params.move_towards_food_reward;
-    float cell_count = game_params.cell_count;
-
-    // Calculate distances
-    float previous_distance = sqrt(pow(previous_head_position.x - food.position.x, 2) + 
-                                   pow(previous_head_position.y - food.position.y, 2));
-    float current_distance = sqrt(pow(snake.body[0].x - food.position.x, 2) + 
-                                  pow(snake.body[0].y - food.position.y, 2));
-
-    // Calculate distance change
-    float distance_change = previous_distance - current_distance;
-
-    std::deque<Vector2> headless_body = snake.body;
-    headless_body.pop_front();
-
-    if (Vector2Equals(snake.body[0], food.position)) {
-        return food_reward;
-    }
-	if (elementInDeque(snake.body[0], headless_body)) {
-        return self_collision_penalty;
-    } 
-	if (snake.body[0].x < 0 || snake.body[0].x >= cell_count || snake.body[0].y < 0 || snake.body[0].y >= cell_count) {
-        return edge_collision_penalty;
-    }
-
-    // Return the reward based on distance change
-    return distance_change * move_towards_food_reward;
-}
+#include "../include/profiler.h"
 
 /*
     Function: getState
 
     Description: Get the state to be stored in replay memory. State consists of
         the positions of the food and snake head, directions the snake is facing
-        and whether there are any obstacles.
+        and whether there are any obstacles, normalised by the size of the snake's board.
+        This is the reference implementation, the game loops use StateEncoder which writes
+        the same values in O(1) without allocating.
 
     Arguments:
         (Snake) snake: The snake object.
@@ -139,32 +30,31 @@ float getReward(const Snake &snake, const Food &food, const Vector2 &previous_he
 
     Code:
 
-    Vector2 head = snake.body[0];
-	Vector2 foodPos = food.position;
-	Vector2 direction = snake.direction;
-    gameParams params;
+    Cell head = snake.head();
+	Cell foodPos = food.position;
+	Cell direction = snake.direction;
+    int cell_count = snake.params.cell_count;
 
 	bool obstacleUp = false, obstacleDown = false, obstacleLeft = false, obstacleRight = false;
 
     Explanation:
 
     Initialise key variables, the snake head position, the food position, the snake's current
-    direction, the game parameters, whether there are any obstacles.
+    direction, the size of the snake's board, whether there are any obstacles.
 
     Code:
 
-    if (elementInDeque(Vector2{head.x, head.y - 1}, snake.body) || head.y - 1 < 0) obstacleUp = true;
-	if (elementInDeque(Vector2{head.x, head.y + 1}, snake.body) || head.y + 1 >= params.cell_count) obstacleDown = false;
-	if (elementInDeque(Vector2{head.x - 1, head.y}, snake.body) || head.x - 1 < 0) obstacleLeft = true;
-	if (elementInDeque(Vector2{head.x + 1, head.y}, snake.body) || head.x + 1 >= params.cell_count) obstacleRight = true;
+    if (snake.occupies(head.x, head.y - 1) || head.y - 1 < 0) obstacleUp = true;
+	if (snake.occupies(head.x, head.y + 1) || head.y + 1 >= params.cell_count) obstacleDown = false;
+	if (snake.occupies(head.x - 1, head.y) || head.x - 1 < 0) obstacleLeft = true;
+	if (snake.occupies(head.x + 1, head.y) || head.x + 1 >= params.cell_count) obstacleRight = true;
 
     Explanation:
 
-	Check for obstacles in each direction. elementInDeque iterates over all elements
-    in the deque and it it finds the input element in the deque it returns true. In 
-    this case iterate over elements in the snake body and see if the snake is pointing 
-    towards its own body (elementInDeque) or (||) it is pointing to outside the game 
-    boundary.
+	Check for obstacles in each direction. snake.occupies looks the cell up in the snake's
+    occupancy bitboard and returns true if part of the body covers it. In this case see if
+    the snake is pointing towards its own body (snake.occupies) or (||) it is pointing to
+    outside the game boundary.
 
     Code:
 
@@ -197,9 +87,9 @@ float getReward(const Snake &snake, const Food &food, const Vector2 &previous_he
     Combine all state values into a vector.
 */ 
 std::vector<float> getState(const Snake &snake, const Food &food) {
-	Vector2 head = snake.body[0];
-	Vector2 foodPos = food.position;
-    GameParams params;
+	Cell head = snake.head();
+	Cell foodPos = food.position;
+    int cell_count = snake.params.cell_count;
 
 	bool obstacleUp = false, obstacleDown = false, obstacleLeft = false, obstacleRight = false;
 
@@ -208,24 +98,24 @@ std::vector<float> getState(const Snake &snake, const Food &food) {
     else if (snake.direction.y == 1) direction = 2;
     else if (snake.direction.x == -1) direction = 3;
 
-	float normalisedHeadX = head.x / (float)params.cell_count;
-	float normalisedHeadY = head.y / (float)params.cell_count;
-    float relativeFoodX = (foodPos.x - head.x) / (float)params.cell_count;
-    float relativeFoodY = (foodPos.y - head.y) / (float)params.cell_count;
+	float normalisedHeadX = head.x / (float)cell_count;
+	float normalisedHeadY = head.y / (float)cell_count;
+    float relativeFoodX = (foodPos.x - head.x) / (float)cell_count;
+    float relativeFoodY = (foodPos.y - head.y) / (float)cell_count;
 
      // Calculate distances to obstacles
     auto distanceToObstacle = [&](int dx, int dy) {
         float distance = 0;
-        float x = head.x + dx, y = head.y + dy;
-        while (x >= 0 && x < params.cell_count && y >= 0 && y < params.cell_count && !elementInDeque(Vector2{x, y}, snake.body)) {
+        int x = head.x + dx, y = head.y + dy;
+        while (x >= 0 && x < cell_count && y >= 0 && y < cell_count && !snake.occupies(x, y)) {
             distance++;
             x += dx;
             y += dy;
         }
-        return distance / (float)params.cell_count;
+        return distance / (float)cell_count;
     };
 
-    float normalisedLength = (snake.body.size() - 1) / (float)(params.cell_count * params.cell_count - 1);
+    float normalisedLength = (snake.body.size() - 1) / (float)(cell_count * cell_count - 1);
 
 	std::vector<float> state = std::vector({
 		normalisedHeadX,
@@ -250,10 +140,17 @@ std::vector<float> getState(const Snake &snake, const Food &food) {
     
     Name: ReplayMemory
 
-    Description: Constructor takes inputs for memory capacity.
+    Description: Constructor takes inputs for memory capacity and state size, and allocates the
+        whole memory up front so that storing an experience never allocates.
 
     Arguments:
-        (size_t) Unsigned integer value, representing the memory capacity.
+        (size_t) capacity: Unsigned integer value, representing the memory capacity.
+        (size_t) state_size: The number of floats in a state, see getState.
+        (uint64_t) seed: The seed of the sampling random number generator, which draws from
+            RNG_STREAM_REPLAY.
+        (bool) prioritized: Use prioritized sampling instead of uniform sampling.
+        (float) priority_alpha: How strongly priorities skew sampling, see network_params.h.
+        (float) priority_epsilon: Added to |td error| so every experience can be sampled.
      
     Returns:
         None
@@ -262,28 +159,72 @@ std::vector<float> getState(const Snake &snake, const Food &food) {
 
     Code:
 
-    ReplayMemory::ReplayMemory(size_t capacity) : capacity(capacity), position(0) {}
+    states(capacity * state_size)
+    next_states(capacity * state_size)
 
     Explanation:
 
-    Assign the capacity attribute to size capacity, then initialise starting position 
-    to zero.
+    Each component of the experiences is held in its own contiguous array. The states and next
+    states are capacity x state_size matrices with one experience per row. Initialise the
+    number of stored experiences and the starting position to zero.
 */
 
-ReplayMemory::ReplayMemory(size_t capacity) : capacity(capacity), position(0) {}
+ReplayMemory::ReplayMemory(size_t capacity, size_t state_size, uint64_t seed, bool prioritized, float priority_alpha, float priority_epsilon)
+    : states(capacity * state_size)
+    , actions(capacity)
+    , rewards(capacity)
+    , next_states(capacity * state_size)
+    , dones(capacity)
+    , capacity(capacity)
+    , state_size(state_size)
+    , size(0)
+    , position(0)
+    , generator(seed, RNG_STREAM_REPLAY)
+    , selected(capacity)
+    , prioritized(prioritized)
+    , priority_alpha(priority_alpha)
+    , priority_epsilon(priority_epsilon)
+    , priority_beta(1.0f)
+    , max_priority(1.0f)
+    , priorities(prioritized ? capacity : 1)
+{}
 
 /*
     Class: ReplayMemory
 
     Component: Method
     
-    Name: add
+    Name: seed
+
+    Description: Reseed the sampling random number generator, so that the sequence of sampled
+        batches can be reproduced.
+
+    Arguments:
+        (uint64_t) seed: The new seed.
+     
+    Returns:
+        None
+*/
+
+void ReplayMemory::seed(uint64_t seed) {
+    generator = Rng(seed, RNG_STREAM_REPLAY);
+}
+
+/*
+    Class: ReplayMemory
+
+    Component: Method
+    
+    Name: storeExperience
 
     Description: Add a new experience to replay memory.
 
     Arguments:
-        (const Experience) The experience struct containing values to be added to
-            replay memory. See the bottom for notes on experience struct.
+        (const float*) state: The state_size floats of the state.
+        (int) action: The action taken.
+        (float) reward: The reward received.
+        (const float*) next_state: The state_size floats of the next state.
+        (bool) done: Whether a terminal state was reached.
      
     Returns:
         None
@@ -292,35 +233,44 @@ ReplayMemory::ReplayMemory(size_t capacity) : capacity(capacity), position(0) {}
     
     Code:
 
-    if (memory.size() < capacity) {
-        memory.push_back(experience);
-    }
+    std::copy(state, state + state_size, states.begin() + position * state_size);
 
     Explanation:
 
+    Copy each component into its row of the preallocated arrays at the current position.
+
+    Code:
+
+    priorities.update(position, max_priority);
+
+    Explanation:
 
+    With prioritized replay a new experience gets the largest priority seen so far, so that it
+    is sampled at least once soon after it is stored.
 
     Code:
 
-    else {
-        memory[position] = experience;
-        position = (position + 1) & capacity;
-    }
+    position = (position + 1) % capacity;
+    size = std::min(size + 1, capacity);
 
     Explanation:
 
-    Fill the memory for current position. If position reaches the end of capacity 
-    the remainder operator brings the value back to 0.
+    If position reaches the end of capacity the remainder operator brings the value back to 0,
+    hence once the memory is full the oldest experience is overwritten.
 */
 
-void ReplayMemory::storeExperience(const Experience& experience) {
-    if (memory.size() < capacity) {
-        memory.push_back(experience);
-    } else {
-        memory[position] = experience;
-        position = (position + 1) % capacity;
+void ReplayMemory::storeExperience(const float* state, int action, float reward, const float* next_state, bool done) {
+    std::copy(state, state + state_size, states.begin() + position * state_size);
+    actions[position] = action;
+    rewards[position] = reward;
+    std::copy(next_state, next_state + state_size, next_states.begin() + position * state_size);
+    dones[position] = done;
+    if (prioritized) {
+        priorities.update(position, max_priority);
     }
-        
+
+    position = (position + 1) % capacity;
+    size = std::min(size + 1, capacity);
 }
 
 /*
@@ -328,74 +278,249 @@ void ReplayMemory::storeExperience(const Experience& experience) {
 
     Component: Method
     
-    Name: sample
+    Name: storeExperience
 
-    Description: Sample a vector of experiences from replay memory of size batch size. 
+    Description: Add a new experience to replay memory from an experience struct. See the
+        bottom for notes on experience struct.
 
     Arguments:
-        (size_t) batch_size: The size of the vector - the batch.
+        (const Experience) The experience struct containing values to be added to
+            replay memory.
      
     Returns:
-        (std::vector) A vector of size batch size, containing experiences from the replay
-            memory.
+        None
+*/
+
+void ReplayMemory::storeExperience(const Experience& experience) {
+    storeExperience(experience.state.data(), experience.action, experience.reward, experience.next_state.data(), experience.done);
+}
+
+/*
+    Class: ReplayMemory
+
+    Component: Method
+    
+    Name: sampleIndices
+
+    Description: Sample batch_size distinct positions of stored experiences uniformly at random,
+        without replacement. This is Floyd's algorithm, which needs exactly batch_size random
+        draws however full the memory is, so the cost is O(batch_size).
+
+    Arguments:
+        (size_t) batch_size: The number of positions to sample, at most the number of stored
+            experiences.
+        (std::vector<size_t>) indices: Filled with the sampled positions.
+     
+    Returns:
+        None
 
     Code Explanation:
     
     Code:
+
+    for (size_t j = size - batch_size; j < size; j++) {
+        size_t t = generator.below((uint32_t)(j + 1));
+        size_t pick = selected[t] ? j : t;
+
+    Explanation:
+
+    For each j from size - batch_size to size - 1 draw t from [0, j]. If t has already been
+    picked, pick j instead, which cannot have been picked yet as every earlier pick is below j.
+    Every subset of batch_size positions is equally likely.
+
+    Code:
+
+    for (size_t index : indices) {
+        selected[index] = 0;
+    }
+
+    Explanation:
+
+    Clear only the marks that were set, so the selected array never needs to be cleared in full.
+*/
+
+void ReplayMemory::sampleIndices(size_t batch_size, std::vector<size_t>& indices) {
+    if (batch_size > size) {
+        throw std::runtime_error("Cannot sample more experiences than are stored in replay memory");
+    }
+
+    indices.clear();
+    for (size_t j = size - batch_size; j < size; j++) {
+        size_t t = generator.below((uint32_t)(j + 1));
+        size_t pick = selected[t] ? j : t;
+        selected[pick] = 1;
+        indices.push_back(pick);
+    }
+
+    for (size_t index : indices) {
+        selected[index] = 0;
+    }
+}
+
+/*
+    Class: ReplayMemory
+
+    Component: Method
+    
+    Name: samplePrioritized
+
+    Description: Sample batch_size positions in proportion to their priorities using the sum
+        tree, in O(batch_size log capacity), together with their importance sampling weights.
+
+    Arguments:
+        (size_t) batch_size: The number of positions to sample.
+        (std::vector<size_t>) indices: Filled with the sampled positions.
+        (std::vector<float>) weights: Filled with the importance sampling weight of each position.
+     
+    Returns:
+        None
+
+    Code Explanation:
     
-    std::vector<Experience> batch;
-    std::vector<int> seen;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(0, memory.size() - 1);
+    Code:
+
+    double segment = priorities.total() / batch_size;
+    double value = segment * (i + generator.uniformDouble());
+    indices[i] = priorities.find(value);
 
     Explanation:
 
-    Initialise key variables. Initialise batch vector to hold experiences. Initialise seen 
-    vector to keep track of the positions of experiences added to batch to ensure that no 
-    same experience is reused. Finally initialise the range to sample the positions values 
-    of the experiences in the replay memory vector.
+    Split the total priority into batch_size equal segments and draw one value from each, this
+    spreads the sample over the whole memory. The sum tree finds the experience whose running
+    sum of priorities contains the value.
 
     Code:
 
-    int i = 0;
-    while (i < batch_size) {
-        int memory_pos = dist(gen);
+    weights[i] = std::pow(size * probability, -priority_beta);
 
     Explanation:
 
-    Use while loop to iterate until batch vector is filled. Generate a position value to
-    pull an experience from the replay memory.
+    Prioritized sampling changes the distribution the expected loss is taken over. The
+    importance sampling weight (N . P(i))^-beta corrects for this, and the weights are divided
+    by the largest weight in the batch so that they only ever scale the updates down.
+*/
 
+void ReplayMemory::samplePrioritized(size_t batch_size, std::vector<size_t>& indices, std::vector<float>& weights) {
+    if (batch_size > size) {
+        throw std::runtime_error("Cannot sample more experiences than are stored in replay memory");
+    }
+
+    indices.resize(batch_size);
+    weights.resize(batch_size);
+
+    double total = priorities.total();
+    double segment = total / batch_size;
+    float max_weight = 0;
+
+    for (size_t i = 0; i < batch_size; i++) {
+        double value = segment * (i + generator.uniformDouble());
+        size_t index = priorities.find(value);
+        if (index >= size) {
+            index = size - 1;
+        }
+        double probability = priorities.get(index) / total;
+
+        indices[i] = index;
+        weights[i] = std::pow(size * probability, -priority_beta);
+        max_weight = std::max(max_weight, weights[i]);
+    }
+
+    for (auto& weight : weights) {
+        weight /= max_weight;
+    }
+}
+
+/*
+    Class: ReplayMemory
+
+    Component: Method
+    
+    Name: sample
+
+    Description: Sample batch_size distinct experiences from replay memory, gathering them
+        directly into the rows of the batch matrices.
+
+    Arguments:
+        (size_t) batch_size: The size of the batch.
+        (Batch) batch: The batch to fill, its buffers are resized to batch_size rows. The sampled
+            positions are kept in batch.indices.
+     
+    Returns:
+        None
+
+    Code Explanation:
+    
     Code:
 
-    if (std::find(seen.begin(), seen.end(), memory_pos) == seen.end()) {
-        batch.push_back(memory[memory_pos]);
-        i++;
+    if (prioritized) {
+        samplePrioritized(batch_size, batch.indices, batch.weights);
+    } else {
+        sampleIndices(batch_size, batch.indices);
+        batch.weights.assign(batch_size, 1.0f);
     }
 
     Explanation:
 
-    Iterate through to check if the generated value for the position of the
-    experience to add to the batch has already been seen. If it has not add
-    it to the batch and increment i.
+    Sample the positions of the experiences, in proportion to their priorities with importance
+    sampling weights for prioritized replay, otherwise uniformly without replacement.
+
+    Code:
+
+    std::copy(state(index), state(index) + state_size, batch.states.begin() + i * state_size);
+
+    Explanation:
+
+    Copy the row of each array at the sampled position into row i of the batch.
 */
 
-std::vector<ReplayMemory::Experience> ReplayMemory::sample(size_t batch_size) {
-    std::vector<Experience> batch;
-    std::vector<int> seen;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(0, memory.size() - 1);
+void ReplayMemory::sample(size_t batch_size, Batch& batch) {
+    if (prioritized) {
+        samplePrioritized(batch_size, batch.indices, batch.weights);
+    } else {
+        sampleIndices(batch_size, batch.indices);
+        batch.weights.assign(batch_size, 1.0f);
+    }
+
+    batch.states.resize(batch_size * state_size);
+    batch.actions.resize(batch_size);
+    batch.rewards.resize(batch_size);
+    batch.next_states.resize(batch_size * state_size);
+    batch.dones.resize(batch_size);
+
+    for (size_t i = 0; i < batch_size; i++) {
+        size_t index = batch.indices[i];
+        std::copy(state(index), state(index) + state_size, batch.states.begin() + i * state_size);
+        batch.actions[i] = actions[index];
+        batch.rewards[i] = rewards[index];
+        std::copy(nextState(index), nextState(index) + state_size, batch.next_states.begin() + i * state_size);
+        batch.dones[i] = dones[index];
+    }
+}
+
+/*
+    Class: ReplayMemory
+
+    Component: Method
     
-    int i = 0;
-    while (i < batch_size) {
-        int memory_pos = dist(gen);
-        if (std::find(seen.begin(), seen.end(), memory_pos) == seen.end()) {
-            batch.push_back(memory[memory_pos]);
-            i++;
-        }
-    } return batch;
+    Name: updatePriorities
+
+    Description: Set the priorities of sampled experiences from their TD errors after a
+        training step, priority = (|td error| + priority_epsilon)^priority_alpha.
+
+    Arguments:
+        (std::vector<size_t>) indices: The positions of the experiences.
+        (std::vector<float>) td_errors: The TD error of each experience.
+     
+    Returns:
+        None
+*/
+
+void ReplayMemory::updatePriorities(const std::vector<size_t>& indices, const std::vector<float>& td_errors) {
+    for (size_t i = 0; i < indices.size(); i++) {
+        float priority = std::pow(std::abs(td_errors[i]) + priority_epsilon, priority_alpha);
+        priorities.update(indices[i], priority);
+        max_priority = std::max(max_priority, priority);
+    }
 }
 
 /*
@@ -425,7 +550,8 @@ std::vector<ReplayMemory::Experience> ReplayMemory::sample(size_t batch_size) {
     Code:
 
     DQN::DQN(int input_size, int output_size, size_t memory_capacity, const NetworkParams& params)
-    : replay_memory(memory_capacity), 
+    : replay_memory(memory_capacity, input_size, rngSeed(params.RANDOM_SEED),
+                    params.prioritized_replay, params.PRIORITY_ALPHA, params.PRIORITY_EPSILON), 
       params(params),
       policy_net(params.LEARNING_RATE),
       target_net(params.LEARNING_RATE)
@@ -448,16 +574,29 @@ to add
 // error checker if sampling theshold is greater than memory capacity
 */
 DQN::DQN(int input_size, int output_size, size_t memory_capacity, const NetworkParams& params)
-    : replay_memory(memory_capacity), 
+    : replay_memory(memory_capacity, input_size, rngSeed(params.RANDOM_SEED),
+                    params.prioritized_replay, params.PRIORITY_ALPHA, params.PRIORITY_EPSILON), 
       params(params),
       policy_net(params.LEARNING_RATE),
       target_net(params.LEARNING_RATE),
-      steps_done(params.steps_done)
+      steps_done(params.steps_done),
+      train_steps(0),
+      random_actions(0),
+      greedy_actions(0),
+      action_generator(rngSeed(params.RANDOM_SEED), RNG_STREAM_ACTIONS)
     {
-        policy_net.add_layer(input_size, 128);
-        policy_net.add_layer(128, 128);
-        policy_net.add_layer(128, output_size);
-        target_net = policy_net;
+        Rng init_generator(rngSeed(params.RANDOM_SEED), RNG_STREAM_LAYER_INIT);
+        policy_net.add_layer(input_size, 128, init_generator);
+        policy_net.add_layer(128, 128, init_generator);
+        policy_net.add_layer(128, output_size, init_generator);
+        policy_net.optimiser = Optimiser(params.OPTIMISER, params.LEARNING_RATE, params.MOMENTUM, params.ADAM_BETA1,
+                                         params.ADAM_BETA2, params.RMSPROP_DECAY, params.OPTIMISER_EPSILON);
+        for (const auto& layer : policy_net.layers) {
+            target_net.add_layer(layer.input_size, layer.output_size);
+        }
+        target_net.copy_parameters(policy_net);
+        action_workspace = NeuralNetwork::Workspace(policy_net, 1);
+        target_workspace = NeuralNetwork::Workspace(target_net, params.BATCH_SIZE);
     }
 
 /*
@@ -469,7 +608,8 @@ DQN::DQN(int input_size, int output_size, size_t memory_capacity, const NetworkP
 
     Description: Update the parameters of the target network to the parameters of
         the policy network after a number of training iterations of the policy
-        network.
+        network. With a TARGET_TAU above zero the target network only moves that
+        fraction of the way towards the policy network, a soft update.
 
     Arguments:
         None
@@ -481,14 +621,20 @@ DQN::DQN(int input_size, int output_size, size_t memory_capacity, const NetworkP
     
     Code:
 
-    target_net = policy_net;
+    target_net.copy_parameters(policy_net);
 
     Explanation:
 
-    Set the target_net to policy_net.
+    Copy only the weights and biases, as one memcpy of the policy network's parameter
+    buffer. The target network is only used for inference, so its training buffers and
+    optimiser state are never needed.
 */
 void DQN::updateTargetNet() {
-    target_net = policy_net;
+    if (params.TARGET_TAU > 0) {
+        target_net.soft_update(policy_net, params.TARGET_TAU);
+    } else {
+        target_net.copy_parameters(policy_net);
+    }
 }
 
 /*
@@ -510,7 +656,7 @@ void DQN::updateTargetNet() {
 
     Code:
 
-    if (replay_memory.capacity < params.sampling_threshold) {
+    if (replay_memory.size < params.SAMPLING_THRESHOLD) {
         return;
     }
 
@@ -521,120 +667,129 @@ void DQN::updateTargetNet() {
 
     Code:
 
-    auto batch = replay_memory.sample(batch_size);
-
-    Explanation:
-
-    Sample a batch of experiences from the replay memory.
-
-    Code:
-
-    for (const auto& exp : batch) {
-        auto q_values = policy_net.forward(exp.state);
-        
-
-    Explanation:
-
-    Iterate through each experience in the batch. 
-
-    Perform forward pass with the current state on the policy neural network.
-    This outputs the predicted Q values. 
-
-    Code:
-
-    auto next_q_values = target_net.forward(exp.next_state);
+    replay_memory.sample(batch_size, batch);
 
     Explanation:
 
-    Perform forward pass with the next state on the target neural network. 
-    This outputs Q values for the next state, and will be used to calculate
-    the target Q value (can be seen as a ground truth).
+    Sample a batch of experiences from the replay memory. The states and next states are
+    gathered into batch_size x state_size matrices, one experience per row, so the whole
+    batch can be passed through the networks at once.
 
     Code:
 
-    float q_update = exp.reward;
+    const std::vector<float>& q_values = policy_net.forward_batch(batch.states, batch_size);
+    const float* next_q_values = target_net.infer_batch(batch.next_states.data(), batch_size, target_workspace);
 
     Explanation:
 
-    Retrieve the actual reward value from the action performed from being in 
-    the current state. This will be used with the Q values output from the 
-    target neural network with the next state inputted for the forward pass.
+    Perform forward pass with the current states on the policy neural network. This outputs
+    the predicted Q values. Perform forward pass with the next states on the target neural
+    network. This outputs Q values for the next states, and will be used to calculate the
+    target Q value (can be seen as a ground truth). The target network is never trained, so
+    it uses the inference pass, which skips keeping the inputs for back propagation.
 
     Code:
 
-    if (!exp.done) {
-        q_update += gamma * *std::max_element(next_q_values.begin(), next_q_values.end());
+    float q_update = batch.rewards[b];
+    if (!batch.dones[b]) {
+        q_update += params.gamma * *std::max_element(next_q, next_q + action_size);
     }
 
     Explanation:
 
-    If not at terminal state, add the max Q value outputted from the target neural network.
-    Here we calculate the temporal difference target estimate. This represents the actual
-    output.
+    Retrieve the actual reward value from the action performed from being in the current
+    state. If not at terminal state, add the max Q value outputted from the target neural
+    network. Here we calculate the temporal difference target estimate. This represents the
+    actual output.
 
     Code:
 
-    std::vector<float> target = q_values;
+    float td_error = q_values[b * action_size + action] - q_update;
+    batch_grad[b * action_size + action] = batch.weights[b] * td_error;
 
     Explanation:
 
-    Set the target vector as the predicted Q values. At there are 4 outputs, for back
-    propagation we need to match this. However since the agent (snake) only performs
-    one action, we only have the actual reward for one action. Hence what we will do
-    is just take the same Q values predicted by the policy neural network with the current
-    weights and for the particular action performed, replace the actual Q value. The 
-    idea is that the other Q values will zero out and provide no contribution, whilst 
-    the actual Q value can be used with the predicted Q value to calculate a loss value.
+    Since the agent (snake) only performs one action, we only have the actual reward for one
+    action. The target for the other Q values is the predicted Q value itself, hence their
+    gradient is zero and they provide no contribution. For the action performed calculate the
+    input gradient for mean squared loss, scaled by the importance sampling weight (one for
+    uniform sampling).
+
+    MSE = 1/2 (Pred - Actual)^2
+    dMSE = Pred - Actual
 
     Code:
 
-    std::vector<float> grad(target.size());
+    replay_memory.updatePriorities(batch.indices, batch_td_errors);
 
     Explanation:
 
-    Setup the vector which holds the input gradients.
+    With prioritized replay, set the priorities of the sampled experiences from their new TD
+    errors.
 
     Code:
 
-    grad[i] = q_values[i] - target[i];
+    policy_net.backward_batch(batch_grad, batch_size);
 
     Explanation:
 
-    Calculate the input gradients for mean squared loss.
-
-    MSE = 1/2 (Pred - Actual)^2
-    dMSE = Pred - Actual
+    Back propagate the gradients of the whole batch and apply one update to the policy network.
 */
 void DQN::train(int batch_size) {
 
-    if (replay_memory.memory.size() < params.SAMPLING_THRESHOLD) {
+    if (replay_memory.size < params.SAMPLING_THRESHOLD) {
         return;
     }
 
-    auto batch = replay_memory.sample(batch_size);
+    // Anneal the importance sampling correction towards full correction.
+    float beta_progress = std::min(1.0f, (float)train_steps / params.PRIORITY_BETA_STEPS);
+    replay_memory.priority_beta = params.PRIORITY_BETA_START + (1.0f - params.PRIORITY_BETA_START) * beta_progress;
+    train_steps++;
+    PROFILE_SCOPE(PHASE_TRAIN);
+    PROFILE_COUNT(COUNTER_GRADIENT_STEPS, 1);
+
+    PROFILE_BEGIN(sample_timer, PHASE_TRAIN_SAMPLE);
+    replay_memory.sample(batch_size, batch);
+    PROFILE_END(sample_timer);
+
+    int action_size = policy_net.layers.back().output_size;
+    batch_grad.assign(batch_size * action_size, 0.0f);
+    batch_td_errors.resize(batch_size);
 
-    for (const auto& exp : batch) {
+    PROFILE_BEGIN(forward_timer, PHASE_TRAIN_FORWARD);
+    const std::vector<float>& q_values = policy_net.forward_batch(batch.states, batch_size); // Q_old
+    PROFILE_END(forward_timer);
 
-        auto q_values = policy_net.forward(exp.state); // Q_old
-        auto next_q_values = target_net.forward(exp.next_state); // Q_target
-        float q_update = exp.reward; // r_current
+    PROFILE_BEGIN(target_timer, PHASE_TRAIN_TARGET_FORWARD);
+    if (batch_size > target_workspace.max_batch_size) {
+        target_workspace = NeuralNetwork::Workspace(target_net, batch_size);
+    }
+    const float* next_q_values = target_net.infer_batch(batch.next_states.data(), batch_size, target_workspace); // Q_target
+    PROFILE_END(target_timer);
+
+    for (int b = 0; b < batch_size; b++) {
+        int action = batch.actions[b];
+        const float* next_q = next_q_values + b * action_size;
+        float q_update = batch.rewards[b]; // r_current
 
-        if (!exp.done) {
-            q_update += params.gamma * *std::max_element(next_q_values.begin(), next_q_values.end());
+        if (!batch.dones[b]) {
+            q_update += params.gamma * *std::max_element(next_q, next_q + action_size);
         } // TD target estimate - Q_actual
 
-        // Only the action performed changed its Q value, hence predicted Q values will zero out
-        // later when we calculate the loss.
-        std::vector<float> target = q_values; 
-        target[exp.action] = q_update; // Replace the actual Q value for the action performed.
+        // Only the action performed changed its Q value, the loss values are zero except for the
+        // action performed as q_values[i] - target[i] = 0.
+        float td_error = q_values[b * action_size + action] - q_update;
+        batch_grad[b * action_size + action] = batch.weights[b] * td_error;
+        batch_td_errors[b] = td_error;
+    }
 
-        // The loss values are zero except for action performed as q_values[i] - target [i] = 0.
-        std::vector<float> grad(target.size());
-        for (size_t i = 0; i < target.size(); i++) {
-            grad[i] = q_values[i] - target[i];
-        }
+    PROFILE_BEGIN(backward_timer, PHASE_TRAIN_BACKWARD);
+    policy_net.backward_batch(batch_grad, batch_size);
+    PROFILE_END(backward_timer);
 
-        policy_net.backward(grad);
+    if (replay_memory.prioritized) {
+        PROFILE_SCOPE(PHASE_TRAIN_PRIORITIES);
+        replay_memory.updatePriorities(batch.indices, batch_td_errors);
     }
 }
 
@@ -645,29 +800,53 @@ void DQN::train(int batch_size) {
     
     Name: argmax
 
-    Description: Finds the argmax of a vector. That is it returns the position of the element
+    Description: Finds the argmax of an array. That is it returns the position of the element
         with the largest value.
 
     Arguments:
-        (std::vector<float>) q_values: The input Q values which represent the Q values of each
+        (const float*) q_values: The input Q values which represent the Q values of each
             action of the snake. There are 4 actions, hence 4 Q values.
+        (int) size: The number of Q values.
      
     Returns:
-        (int) The position of the maximum element in the vector.
+        (int) The position of the maximum element in the array.
 
     Code Explanation:
     
     Code:
 
-    return std::distance(q_values.begin(), std::max_element(q_values.begin(), q_values.end()));
+    return std::distance(q_values, std::max_element(q_values, q_values + size));
 
     Explanation:
 
     The std::distance function calculates the distance between two elements, in this case the first
-    Q value of the vector, and the maximum Q value. This will return the position of the maximum element.
+    Q value of the array, and the maximum Q value. This will return the position of the maximum element.
 */
-int DQN::argmax(std::vector<float> q_values) {
-    return std::distance(q_values.begin(), std::max_element(q_values.begin(), q_values.end()));
+int DQN::argmax(const float* q_values, int size) {
+    return std::distance(q_values, std::max_element(q_values, q_values + size));
+}
+
+/*
+    Class: DQN
+
+    Component: Method
+    
+    Name: qValues
+
+    Description: Evaluate the live policy network for one state. This goes through
+        NeuralNetwork::infer, which neither copies nor modifies the network, with the
+        workspace allocated once in the constructor, so it does not allocate. The workspace
+        belongs to the DQN, other threads evaluating policy_net need their own.
+
+    Arguments:
+        (const float*) state: The state, STATE_SIZE floats.
+     
+    Returns:
+        (const float*) The Q value of each action. Points into action_workspace, so it is
+            valid until the next call.
+*/
+const float* DQN::qValues(const float* state) {
+    return policy_net.infer(state, action_workspace);
 }
 
 /*
@@ -689,9 +868,8 @@ int DQN::argmax(std::vector<float> q_values) {
         exploitation at the end.
 
     Arguments:
-        (const std::vector<float>) state: The input state, that will be passed through the policy network
+        (const float*) state: The input state, that will be passed through the policy network
             to determine the Q values, thus the best action to perform.
-        (NeuralNetwork) policy_net: The neural network that calculates what action to perform.
         (int) episode_number: An integer which keeps track of the episode number, which is a count for the
             number of iterations that the snake has went through. Note this is different to steps_done, which
             is a count for the decay of epsilon. Episodes is the universal "time" of that the snake has experienced.
@@ -703,14 +881,12 @@ int DQN::argmax(std::vector<float> q_values) {
     
     Code:
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist_action(0, 3);
-    std::uniform_real_distribution<> dist_epsilon(0, 1.0);
+    int action_size = policy_net.layers.back().output_size;
 
     Explanation:
 
-    Create a generator for selecting values for random actions and one for epsilon. Assuming we are beyond
+    Random actions are drawn from [0, action_size) and the value compared with epsilon from [0, 1),
+    both by action_generator which is seeded once in the constructor. Assuming we are beyond
     the minimum exploration threshold - that is a threshold which ensures a sufficient amount of the replay
     memory has been filled. the epsilon determines if a random action will be taken, if it is below the 
     epsilon threshold.
@@ -718,7 +894,7 @@ int DQN::argmax(std::vector<float> q_values) {
     Code:
 
     if (params.MINIMUM_EXPLORATION_THRESHOLD < episode_number) {
-        return dist_action(gen);
+        return action_generator.below(action_size);
     }
 
     Explanation:
@@ -747,9 +923,8 @@ int DQN::argmax(std::vector<float> q_values) {
 
     Code:
 
-    if (dist_epsilon(gen) > epsilon) {
-        std::vector<float> q_values = policy_net.forward(state);
-        return DQN::argmax(q_values);
+    if (action_generator.uniform() > epsilon) {
+        return DQN::argmax(qValues(state), action_size);
     }
 
     Explanation:
@@ -762,7 +937,7 @@ int DQN::argmax(std::vector<float> q_values) {
     Code:
 
     else {
-        return dist_action(gen);
+        return action_generator.below(action_size);
     }
 
     Explanation:
@@ -771,32 +946,145 @@ int DQN::argmax(std::vector<float> q_values) {
     action.
 
 */
-int DQN::selectActionTrain(const std::vector<float>& state, NeuralNetwork policy_net, int episode_number) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist_action(0, 3);
-    std::uniform_real_distribution<> dist_epsilon(0, 1.0);
+int DQN::selectActionTrain(const float* state, int episode_number) {
+    int action_size = policy_net.layers.back().output_size;
     
     if (params.MINIMUM_EXPLORATION_THRESHOLD > episode_number) {
-        std::cout << "Random action selected" << std::endl;
-        return dist_action(gen);
+        LOG_TRACE("Random action selected");
+        countAction(false, 1.0f);
+        return action_generator.below(action_size);
     }
 
     float epsilon = params.EPSILON_END + (params.EPSILON_START - params.EPSILON_END) * exp(-1.0 * DQN::steps_done / params.EPSILON_DECAY);
-    std::cout << "epsilon: " << epsilon << std::endl;
+    LOG_TRACE("epsilon: " << epsilon);
 
     DQN::steps_done++;
-    if (dist_epsilon(gen) > epsilon) {
-        std::cout << "Best action selected" << std::endl;
-        std::vector<float> q_values = policy_net.forward(state);
-        return DQN::argmax(q_values);
+    if (action_generator.uniform() > epsilon) {
+        LOG_TRACE("Best action selected");
+        countAction(true, epsilon);
+        return DQN::argmax(qValues(state), action_size);
     } else {
-        std::cout << "Random action selected" << std::endl;
-        return dist_action(gen);
+        LOG_TRACE("Random action selected");
+        countAction(false, epsilon);
+        return action_generator.below(action_size);
     }
 
 }
 
+/*
+    Class: DQN
+
+    Component: Method
+
+    Name: selectActionsTrain
+
+    Description: Epsilon greedy actions for the states of many games at once, such as the games
+        of a VectorEnvironment. Each game is treated as selectActionTrain treats one state, with
+        game i at episode episode_number + i, but the Q values of every game come from a single
+        batched pass through the policy network instead of one pass per game.
+
+    Arguments:
+        (const float*) states: num_states x STATE_SIZE row-major matrix of states.
+        (int) num_states: The number of games.
+        (int) episode_number: The episode number of the first game, see selectActionTrain.
+        (int*) actions: Set to the action of each game, num_states ints.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    actions[i] = -1;
+
+    Explanation:
+
+    The first pass makes the epsilon draw of every game, in order, and picks the random actions
+    straight away. The games which take the greedy action are marked, and only if there is at
+    least one is the policy network evaluated.
+
+    Code:
+
+    const float* q_values = policy_net.infer_batch(states, num_states, states_workspace);
+
+    Explanation:
+
+    One batched inference over the whole states matrix, a matrix product per layer rather than
+    num_states matrix vector products. The workspace is kept between calls and only grows if
+    more states are passed than before.
+*/
+void DQN::selectActionsTrain(const float* states, int num_states, int episode_number, int* actions) {
+    int action_size = policy_net.layers.back().output_size;
+
+    bool any_greedy = false;
+    for (int i = 0; i < num_states; i++) {
+        if (params.MINIMUM_EXPLORATION_THRESHOLD > episode_number + i) {
+            countAction(false, 1.0f);
+            actions[i] = action_generator.below(action_size);
+            continue;
+        }
+
+        float epsilon = params.EPSILON_END + (params.EPSILON_START - params.EPSILON_END) * exp(-1.0 * DQN::steps_done / params.EPSILON_DECAY);
+        DQN::steps_done++;
+        if (action_generator.uniform() > epsilon) {
+            countAction(true, epsilon);
+            actions[i] = -1;
+            any_greedy = true;
+        } else {
+            countAction(false, epsilon);
+            actions[i] = action_generator.below(action_size);
+        }
+    }
+    if (!any_greedy) {
+        return;
+    }
+
+    if (num_states > states_workspace.max_batch_size) {
+        states_workspace = NeuralNetwork::Workspace(policy_net, num_states);
+    }
+    const float* q_values = policy_net.infer_batch(states, num_states, states_workspace);
+    for (int i = 0; i < num_states; i++) {
+        if (actions[i] == -1) {
+            actions[i] = DQN::argmax(q_values + i * action_size, action_size);
+        }
+    }
+}
+
+/*
+    Class: DQN
+
+    Component: Method
+
+    Name: countAction
+
+    Description: Count an action chosen by selectActionTrain, and every ACTION_SUMMARY_INTERVAL
+        actions log how many were greedy and random and the current epsilon, in place of a line
+        per action.
+
+    Arguments:
+        (bool) greedy: True if the action was the argmax of the Q values.
+        (float) epsilon: The exploration probability the action was chosen with.
+
+    Returns:
+        None
+*/
+void DQN::countAction(bool greedy, float epsilon) {
+    if (greedy) {
+        greedy_actions++;
+    } else {
+        random_actions++;
+    }
+
+    long count = greedy_actions + random_actions;
+    if (params.ACTION_SUMMARY_INTERVAL > 0 && count >= params.ACTION_SUMMARY_INTERVAL) {
+        LOG_INFO("actions: " << count << " ::: greedy: " << 100.0 * greedy_actions / count << "% ::: random: "
+                 << 100.0 * random_actions / count << "% ::: epsilon: " << epsilon << " ::: training steps: " << train_steps);
+        greedy_actions = 0;
+        random_actions = 0;
+    }
+}
+
 /*
     Class: ReplayMemory
 
@@ -819,7 +1107,6 @@ int DQN::selectActionTrain(const std::vector<float>& state, NeuralNetwork policy
         None
 */
 
-int DQN::selectActionTest(const std::vector<float>& state, NeuralNetwork policy_net) {
-    std::vector<float> q_values = policy_net.forward(state);
-    return DQN::argmax(q_values);
+int DQN::selectActionTest(const float* state) {
+    return DQN::argmax(qValues(state), policy_net.layers.back().output_size);
 }
\ No newline at end of file
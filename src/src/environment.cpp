@@ -0,0 +1,353 @@
+#include "../include/dqn.h"
+#include "../include/environment.h"
+#include "../include/profiler.h"
+
+/*
+    Function: applyAction
+
+    Description: Change the direction of the snake from an action value. The snake cannot
+        reverse onto itself, hence an action opposite to the current direction is ignored.
+        Any accepted action sets the game to active.
+
+    Arguments:
+        (Game) game: The game whose snake is being steered.
+        (int) action: The action value, see the Actions enum.
+
+    Returns:
+        None
+*/
+void applyAction(Game &game, int action) {
+    switch(action) {
+        case UP:
+            if (game.snake.direction.y != 1) {
+                game.snake.direction = {0, -1};
+                game.game_running = true;
+            }
+            break;
+        case DOWN:
+            if (game.snake.direction.y != -1) {
+                game.snake.direction = {0, 1};
+                game.game_running = true;
+            }
+            break;
+        case LEFT:
+            if (game.snake.direction.x != 1) {
+                game.snake.direction = {-1, 0};
+                game.game_running = true;
+            }
+            break;
+        case RIGHT:
+            if (game.snake.direction.x != -1) {
+                game.snake.direction = {1, 0};
+                game.game_running = true;
+            }
+            break;
+    }
+}
+
+/*
+    Class: StateEncoder
+
+    Component: Constructor
+
+    Name: StateEncoder
+
+    Description: Set up the encoder for the board size of the game parameters.
+
+    Arguments:
+        (GameParams) params: The game parameters, only the cell count is used.
+
+    Returns:
+        None
+*/
+StateEncoder::StateEncoder(const GameParams& params)
+    : cell_count(params.cell_count)
+{}
+
+/*
+    Class: StateEncoder
+
+    Component: Method
+
+    Name: encode
+
+    Description: Write the state of a game into STATE_SIZE floats. The features and their
+        order are the same as getState, and so are the values, bit for bit: the head position,
+        the food position relative to the head, the direction, the length and the distance to
+        the nearest obstacle looking up, down, left and right. Every feature is O(1) however
+        long the snake is and however large the board.
+
+    Arguments:
+        (Snake) snake: The snake object.
+        (Food) food: The food object.
+        (float*) state: Where to write the STATE_SIZE features, usually a row of a states matrix.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    state[6] = obstacleDistance(snake, 0, -1) / (float)cell_count;
+
+    Explanation:
+
+    The obstacle distances are the only features which used to depend on the board, getState
+    walks cell by cell from the head. obstacleDistance answers the same question from the
+    snake's occupancy bitboard, which the snake updates from the new head and old tail cell on
+    every move.
+*/
+void StateEncoder::encode(const Snake& snake, const Food& food, float* state) const {
+    Cell head = snake.head();
+
+    float direction = 0;
+    if (snake.direction.x == 1) direction = 1;
+    else if (snake.direction.y == 1) direction = 2;
+    else if (snake.direction.x == -1) direction = 3;
+
+    state[0] = head.x / (float)cell_count;
+    state[1] = head.y / (float)cell_count;
+    state[2] = (food.position.x - head.x) / (float)cell_count;
+    state[3] = (food.position.y - head.y) / (float)cell_count;
+    state[4] = direction / 3.0f;
+    state[5] = (snake.body.size() - 1) / (float)(cell_count * cell_count - 1);
+    state[6] = obstacleDistance(snake, 0, -1) / (float)cell_count;
+    state[7] = obstacleDistance(snake, 0, 1) / (float)cell_count;
+    state[8] = obstacleDistance(snake, -1, 0) / (float)cell_count;
+    state[9] = obstacleDistance(snake, 1, 0) / (float)cell_count;
+}
+
+/*
+    Class: StateEncoder
+
+    Component: Method
+
+    Name: obstacleDistance
+
+    Description: Count the free cells between the snake head and the nearest body segment or
+        edge in one direction.
+
+    Arguments:
+        (Snake) snake: The snake object.
+        (int) dx: The x step of the direction, -1, 0 or 1.
+        (int) dy: The y step of the direction, -1, 0 or 1.
+
+    Returns:
+        (int) The number of free cells.
+
+    Code Explanation:
+
+    Code:
+
+    return snake.occupancy.freeRun(head.x, head.y, dx, dy);
+
+    Explanation:
+
+    A single bit scan of the row or column mask holding the head, see Bitboard::freeRun. When
+    nothing checks collisions, as in the test loop, the head can leave the board, in which case
+    fall back to walking the cells one at a time like getState.
+*/
+int StateEncoder::obstacleDistance(const Snake& snake, int dx, int dy) const {
+    Cell head = snake.head();
+    if (snake.occupancy.inside(head.x, head.y)) {
+        return snake.occupancy.freeRun(head.x, head.y, dx, dy);
+    }
+
+    int distance = 0;
+    int x = head.x + dx, y = head.y + dy;
+    while (snake.occupancy.inside(x, y) && !snake.occupies(x, y)) {
+        distance++;
+        x += dx;
+        y += dy;
+    }
+    return distance;
+}
+
+/*
+    Class: VectorEnvironment
+
+    Component: Constructor
+
+    Name: VectorEnvironment
+
+    Description: Create num_envs independent games which are stepped together in lockstep. The
+        states of all games are held in one contiguous row-major matrix so that they can be
+        passed to the policy network as a batch.
+
+    Arguments:
+        (int) num_envs: The number of games to run.
+        (GameParams) params: The game parameters shared by every game.
+        (NetworkParams) network_params: The training parameters, holds the reward values.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    games.reserve(num_envs);
+    for (int i = 0; i < num_envs; i++) {
+        GameParams game_params = params;
+        if (params.random_seed >= 0) {
+            game_params.random_seed = params.random_seed + i;
+        }
+        games.emplace_back(false, 0, game_params, 0);
+    }
+
+    Explanation:
+
+    Construct every game in place, each game places its own food with a random position. With
+    a fixed seed every game gets a different seed, otherwise all games would place their food
+    in the same sequence.
+*/
+VectorEnvironment::VectorEnvironment(int num_envs, const GameParams& params, const NetworkParams& network_params)
+    : states(num_envs * STATE_SIZE)
+    , previous_states(num_envs * STATE_SIZE)
+    , rewards(num_envs)
+    , dones(num_envs)
+    , previous_head_positions(num_envs)
+    , encoder(params)
+    , reward_engine(network_params, params)
+    , num_envs(num_envs)
+{
+    games.reserve(num_envs);
+    for (int i = 0; i < num_envs; i++) {
+        GameParams game_params = params;
+        if (params.random_seed >= 0) {
+            game_params.random_seed = params.random_seed + i;
+        }
+        games.emplace_back(false, 0, game_params, 0);
+    }
+    reset();
+}
+
+/*
+    Class: VectorEnvironment
+
+    Component: Method
+
+    Name: state
+
+    Description: Get the row of the states matrix for one game.
+
+    Arguments:
+        (int) env: The game index.
+
+    Returns:
+        (const float*) Pointer to the STATE_SIZE floats of the current state of the game.
+*/
+const float* VectorEnvironment::state(int env) const {
+    return states.data() + env * STATE_SIZE;
+}
+
+/*
+    Class: VectorEnvironment
+
+    Component: Method
+
+    Name: previousState
+
+    Description: Get the state a game was in when the last action was selected, together with
+        state() this gives the state and next state of the last transition.
+
+    Arguments:
+        (int) env: The game index.
+
+    Returns:
+        (const float*) Pointer to the STATE_SIZE floats of the previous state of the game.
+*/
+const float* VectorEnvironment::previousState(int env) const {
+    return previous_states.data() + env * STATE_SIZE;
+}
+
+/*
+    Class: VectorEnvironment
+
+    Component: Method
+
+    Name: reset
+
+    Description: Put every game back to its starting position with new food, and recompute
+        the states matrix.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+void VectorEnvironment::reset() {
+    for (int i = 0; i < num_envs; i++) {
+        Game &game = games[i];
+        game.snake.reset();
+        game.food.position = game.food.generateRandomPos(game.snake);
+        game.game_running = false;
+        game.score = 0;
+
+        encoder.encode(game.snake, game.food, states.data() + i * STATE_SIZE);
+        rewards[i] = 0;
+        dones[i] = 0;
+    }
+}
+
+/*
+    Class: VectorEnvironment
+
+    Component: Method
+
+    Name: step
+
+    Description: Apply one action to every game and advance them all by one step. This follows
+        the same sequence as the single game training loop: apply the action, move the snake,
+        calculate the reward, check collisions and get the next state. Games which reach a
+        terminal state are reset by Game::gameOver, so the next state of a finished game is the
+        starting state of the next game.
+
+    Arguments:
+        (std::vector<int>) actions: One action per game.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    states.swap(previous_states);
+
+    Explanation:
+
+    The current states become the previous states, the new states are written over the old
+    previous states by the encoder. This avoids copying the states matrix every step.
+*/
+void VectorEnvironment::step(const std::vector<int>& actions) {
+    PROFILE_SCOPE(PHASE_ENVIRONMENT_STEP);
+    states.swap(previous_states);
+
+    for (int i = 0; i < num_envs; i++) {
+        Game &game = games[i];
+        previous_head_positions[i] = game.snake.head();
+
+        PROFILE_BEGIN(update_timer, PHASE_SNAKE_UPDATE);
+        applyAction(game, actions[i]);
+        game.snake.update();
+        PROFILE_END(update_timer);
+
+        PROFILE_BEGIN(reward_timer, PHASE_REWARD);
+        rewards[i] = reward_engine.reward(game.snake, game.food, previous_head_positions[i]);
+        PROFILE_END(reward_timer);
+
+        PROFILE_BEGIN(collision_timer, PHASE_COLLISIONS);
+        game.checkCollisions();
+        PROFILE_END(collision_timer);
+
+        PROFILE_BEGIN(encode_timer, PHASE_ENCODE_STATE);
+        encoder.encode(game.snake, game.food, states.data() + i * STATE_SIZE);
+        PROFILE_END(encode_timer);
+        dones[i] = !game.game_running;
+        PROFILE_COUNT(COUNTER_GAMES, dones[i]);
+    }
+    PROFILE_COUNT(COUNTER_ENV_STEPS, num_envs);
+}
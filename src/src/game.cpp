@@ -1,49 +1,73 @@
+#include <stdexcept>
+#include <string>
+
 #include "../include/game.h"
 
 /*
-    Function: elementInDeque
+    Function: toCell
 
-    Description: Checks if a cell (element) is within a deque. This is important
-        to check collision, such as if the snake's head is on the game boundary
-        or if the snake's head has collided with itself.
+    Description: Convert a raylib position, as used by the game parameters, into the integer
+        cell coordinates the simulation works in.
 
     Arguments:
-        (Vector2) element: The element to check.
-        (std::deque<Vector2>) deque: The deque to iterate over to check if the element
-            is within it.
+        (Vector2) position: The position to convert, its components are whole numbers.
      
     Returns:
-        (bool) Returns true if element is within deque, else return false.
+        (Cell) The cell at that position.
+*/ 
+Cell toCell(Vector2 position) {
+    return Cell{(int16_t)position.x, (int16_t)position.y};
+}
 
-    Code explanation:
+/*
+    Class: BoardParams
 
-    Code:
+    Component: Constructor
 
-    for (int i = 0; i < deque.size(); i++) {}
+    Name: BoardParams
 
-    Explanation:
+    Description: Copy the settings the game uses out of the game parameters, converting the start
+        body and direction into cells.
 
-    Iterate through the deque.
+    Arguments:
+        (GameParams) params: The game parameters.
 
-    Code: 
+    Returns:
+        None
 
-    if (Vector2Equals(deque[i], element)) {
-            return true;
-        }
-    } return false;
+    Code Explanation:
 
-    Explanation:
+    Code:
 
-    If the element has the same Vector2 position as the iterated deque element
-    return true else return false.
+    if (params.cell_count > MAX_CELL_COUNT) {
 
-*/ 
-bool elementInDeque(Vector2 element, std::deque<Vector2> deque) {
-    for (int i = 0; i < deque.size(); i++) {
-        if (Vector2Equals(deque[i], element)) {
-            return true;
-        }
-    } return false;
+    Explanation:
+
+    The body, the bitboard and the free cell list have room for a board of at most MAX_CELL_COUNT
+    cells across, and at most MAX_START_LENGTH start segments are kept, so larger settings are
+    rejected here rather than overrunning them later.
+*/
+BoardParams::BoardParams(const GameParams& params)
+    : cell_count(params.cell_count)
+    , random_seed(params.random_seed)
+    , start_body()
+    , start_length((int)params.body.size())
+    , start_direction(toCell(params.direction))
+    , start_add_segment(params.add_segment)
+    , cell_size(params.cell_size)
+    , offset(params.offset)
+    , dark_green(params.dark_green)
+    , white(params.white)
+{
+    if (params.cell_count > MAX_CELL_COUNT) {
+        throw std::runtime_error("cell_count " + std::to_string(params.cell_count) + " is larger than MAX_CELL_COUNT " + std::to_string(MAX_CELL_COUNT));
+    }
+    if (params.body.empty() || params.body.size() > (size_t)MAX_START_LENGTH) {
+        throw std::runtime_error("The start body has " + std::to_string(params.body.size()) + " segments, it must have between 1 and " + std::to_string(MAX_START_LENGTH));
+    }
+    for (int i = 0; i < start_length; i++) {
+        start_body[i] = toCell(params.body[i]);
+    }
 }
 
 /*
@@ -55,7 +79,8 @@ bool elementInDeque(Vector2 element, std::deque<Vector2> deque) {
 
     Description: The constructor which sets up the attributes of the Snake, the initial body
         position, direction the snake is facing and a bool to determine whether to add segments
-        to the body if food is collided with.
+        to the body if food is collided with. The body is a fixed capacity ring buffer of integer
+        cells, so the board can be at most MAX_CELL_COUNT cells wide.
 
     Arguments:
         (GameParams) params: The game parameters. Holds the parameters for the snake
@@ -66,11 +91,87 @@ bool elementInDeque(Vector2 element, std::deque<Vector2> deque) {
         None
 */ 
 Snake::Snake(const GameParams& params)
-    : body(params.body)
-    , add_segment(params.add_segment)
+    : add_segment(params.add_segment)
     , params(params)
-    , direction(params.direction)
-{}
+    , occupancy(params.cell_count)
+    , free_cells(params.cell_count)
+    , head_collision(false)
+    , overlapping(false)
+{
+    reset();
+}
+
+/*
+    Class: Snake
+
+    Component: Method
+
+    Name: rebuildOccupancy
+
+    Description: Recalculate the occupancy bitboard and the free cell list from the body
+        segments, in O(length + cells). Only needed on reset, or once segments overlap, otherwise
+        update keeps both in step.
+
+    Arguments:
+        None
+     
+    Returns:
+        None
+*/ 
+void Snake::rebuildOccupancy() {
+    occupancy.clear();
+    free_cells.fill();
+    for (int i = 0; i < body.size(); i++) {
+        occupy(body[i]);
+    }
+}
+
+/*
+    Class: Snake
+
+    Component: Method
+
+    Name: occupy
+
+    Description: Mark a cell as covered by the body, in the occupancy bitboard and the free
+        cell list. Cells outside the board and cells which are already covered are left alone.
+
+    Arguments:
+        (Cell) cell: The cell.
+     
+    Returns:
+        None
+*/ 
+void Snake::occupy(Cell cell) {
+    if (occupancy.inside(cell.x, cell.y) && !occupancy.test(cell.x, cell.y)) {
+        occupancy.set(cell.x, cell.y);
+        free_cells.remove(cell.x, cell.y);
+    }
+}
+
+/*
+    Class: Snake
+
+    Component: Method
+
+    Name: vacate
+
+    Description: Mark a cell as no longer covered by the body, in the occupancy bitboard and
+        the free cell list. Cells outside the board and cells which are already free are left
+        alone.
+
+    Arguments:
+        (Cell) cell: The cell.
+     
+    Returns:
+        None
+*/ 
+void Snake::vacate(Cell cell) {
+    if (occupancy.inside(cell.x, cell.y) && occupancy.test(cell.x, cell.y)) {
+        occupancy.reset(cell.x, cell.y);
+        free_cells.add(cell.x, cell.y);
+    }
+}
 
 /*
     Class: Snake
@@ -144,24 +245,54 @@ void Snake::draw() {
 
     Code:
 
-    body.push_front(Vector2Add(body[0], direction));
+    Cell head = {(int16_t)(body.front().x + direction.x), (int16_t)(body.front().y + direction.y)};
+    body.pushFront(head);
+
+    Explanation:
+
+    Push the cell in front of the snake head - which is calculated from the addition of
+    the snake head and the direction it is moving - onto the front of the body. If add_segment
+    is true, hence the snake collided with a food, there is no need to remove the last body
+    component as the snake's body needs to increase in size when colliding with food. Otherwise
+    pop the final part first. The body is a ring buffer, so neither end allocates or moves
+    the other segments.
+
+    Code:
+
+    head_collision = occupies(head);
+    occupy(head);
 
     Explanation:
 
-    Use deque method to push a coordinate value to the coordinate point in front of
-    the snake head - which is calculated from the addition of the coordinate point
-    of the snake head and the direction it is moving. If add_segment is true, hence
-    the snake collided with a food, there is no need to remove the last body component
-    as the snake's body needs to increase in size when colliding with food. Otherwise
-    pop the final part.
+    Keep the occupancy bitboard and the free cell list in step with the body, see occupy
+    and vacate. The tail cell is cleared when the
+    tail is popped, then the head collides with the body if its new cell is still occupied,
+    and finally the head cell is set. This is O(1) however long the snake is. Once two
+    segments share a cell, clearing the tail cell could clear a cell that is still covered,
+    hence until the next reset the bitboard is rebuilt from the body instead. Cells outside
+    the board are never occupied, a head outside the board is an edge collision instead.
 */ 
 void Snake::update() {
-    body.push_front(Vector2Add(body[0], direction));
+    Cell head = {(int16_t)(body.front().x + direction.x), (int16_t)(body.front().y + direction.y)};
     if (add_segment == true) {
         add_segment = false;
     } else {
-        body.pop_back();
+        Cell tail = body.back();
+        body.popBack();
+        if (!overlapping) {
+            vacate(tail);
+        }
+    }
+
+    if (overlapping) {
+        rebuildOccupancy();
+    }
+    head_collision = occupies(head);
+    if (head_collision) {
+        overlapping = true;
     }
+    body.pushFront(head);
+    occupy(head);
 }
 
 /*
@@ -184,17 +315,27 @@ void Snake::update() {
 
     Code:
 
-    body = body;
-    direction = direction;
+    body.clear();
+    for (int i = 0; i < params.start_length; i++) {
+        body.pushBack(params.start_body[i]);
+    }
+    direction = params.start_direction;
 
     Explanation:
 
-    Set the body and direction to the initial coordinate values.
+    Set the body and direction to the initial coordinate values, and rebuild the occupancy
+    bitboard for the initial body.
 
 */
 void Snake::reset() {
-    body = params.body;
-    direction = params.direction;
+    body.clear();
+    for (int i = 0; i < params.start_length; i++) {
+        body.pushBack(params.start_body[i]);
+    }
+    direction = params.start_direction;
+    head_collision = false;
+    overlapping = false;
+    rebuildOccupancy();
 }
 
 /*
@@ -204,11 +345,13 @@ void Snake::reset() {
 
     Name: Food
 
-    Description: The constructor for the food class sets up the food position.
+    Description: The constructor for the food class sets up the random number generator and
+        the food position.
 
     Arguments:
-        (GameParams) params: The game parameters. Holds the parameters for the snake
-            body's initial position and other parameters such as window properties.
+        (Snake) snake: The snake, whose body the food must avoid.
+        (GameParams) params: The game parameters. Holds the seed of the food placement and
+            other parameters such as window properties.
      
     Returns:
         None
@@ -217,52 +360,29 @@ void Snake::reset() {
 
     Code:
 
-    position = GenerateRandomPos(snakeBody);
+    generator(rngSeed(params.random_seed), RNG_STREAM_FOOD)
 
     Explanation:
 
-    Generate the position of the food, avoiding any positions which are the components of the snake
-    body.
-
-*/
-Food::Food(std::deque<Vector2> snake_body, const GameParams& params) 
-    : position(position)
-    , params(params) 
-{
-position = generateRandomPos(snake_body);
-}
-
-/*
-    Class: Food
-
-    Component: Method
-
-    Name: generateRandomCell
-
-    Description: Generate a random cell to position the food.
-
-    Arguments:
-        None
-        
-    Returns:
-        (Vector2) A Vector2 value, which represents the generated random coordinate.
-
-    Code Explanation:
+    A fixed seed makes the sequence of food positions, and hence a whole game for a given
+    sequence of actions, repeatable. Each food object has its own generator, so games do not
+    disturb each other's sequences.
 
     Code:
 
-    float x = GetRandomValue(0, params.cell_count - 1);
-    float y = GetRandomValue(0, params.cell_count - 1);
+    position = generateRandomPos(snake);
 
     Explanation:
 
-    Generate random value within the game area.
+    Generate the position of the food, avoiding any positions which are the components of the snake
+    body.
 
 */
-Vector2 Food::generateRandomCell() {
-    float x = GetRandomValue(0, params.cell_count - 1);
-    float y = GetRandomValue(0, params.cell_count - 1);
-    return Vector2{x, y};
+Food::Food(const Snake& snake, const GameParams& params) 
+    : params(params)
+    , generator(rngSeed(params.random_seed), RNG_STREAM_FOOD)
+{
+position = generateRandomPos(snake);
 }
 
 /*
@@ -272,42 +392,32 @@ Vector2 Food::generateRandomCell() {
 
     Name: generateRandomPos
 
-    Description: Generate a random cell to position of the food. If the position generated
-        is within the snake body, generate a new one until a position is generated outside 
-        the snake body.
+    Description: Pick a uniformly random cell which is not covered by the snake, in O(1)
+        however full the board is.
 
     Arguments:
-        None
+        (Snake) snake: The snake, whose body the food must avoid.
         
     Returns:
-        (Vector2) The position of the food.
+        (Cell) The position of the food. If the snake covers the whole board there is nowhere
+            to put the food, and the position is (-1, -1), outside the board.
 
     Code Explanation:
 
     Code:
 
-    Vector2 position = generateRandomCell();
-
-    Explanation:
-
-    Generate random value within the game area.
-
-    Code:
-
-    while(elementInDeque(position, snake_body)) {
-        position = generateRandomCell();
-    }
+    return snake.free_cells.at(generator.below(snake.free_cells.size()));
 
     Explanation:
 
-    Generate a random position until a position is generate that is outside the 
-    snake's body.
+    The snake keeps a list of the cells it does not cover up to date as it moves, so pick a
+    random entry of the list.
 */
-Vector2 Food::generateRandomPos(std::deque<Vector2> snake_body) {
-    Vector2 position = generateRandomCell();
-    while(elementInDeque(position, snake_body)) {
-        position = generateRandomCell();
-    } return position;
+Cell Food::generateRandomPos(const Snake& snake) {
+    if (snake.free_cells.size() == 0) {
+        return Cell{-1, -1};
+    }
+    return snake.free_cells.at(generator.below(snake.free_cells.size()));
 }
 
 /*
@@ -362,7 +472,7 @@ void Food::draw() {
 
     Game::Game(bool game_running, int score, const GameParams& params) 
         : snake(params)
-        , food(snake.body, params)
+        , food(snake, params)
         , game_running(game_running)
         , score(score)
         , params(params)
@@ -377,7 +487,7 @@ void Food::draw() {
 */
 Game::Game(bool game_running, int score, const GameParams& params, float last_update_time) 
     : snake(params)
-    , food(snake.body, params)
+    , food(snake, params)
     , game_running(game_running)
     , score(score)
     , params(params)
@@ -500,7 +610,7 @@ void Game::checkCollisions() {
 
     Code:
 
-    if (Vector2Equals(snake.body[0], food.position))
+    if (snake.head() == food.position)
 
     Explanation
 
@@ -508,7 +618,7 @@ void Game::checkCollisions() {
 
     Code:
 
-    food.position = food.generateRandomPos(snake.body);
+    food.position = food.generateRandomPos(snake);
 
     Explanation
 
@@ -531,8 +641,8 @@ void Game::checkCollisions() {
     Increment score.
 */
 void Game::checkCollisionWithFood() {
-    if (Vector2Equals(snake.body[0], food.position)) {
-        food.position = food.generateRandomPos(snake.body);
+    if (snake.head() == food.position) {
+        food.position = food.generateRandomPos(snake);
         snake.add_segment = true;
         score++;
     }
@@ -557,10 +667,10 @@ void Game::checkCollisionWithFood() {
 
     Code:
 
-    if (snake.body[0].x == params.cell_count || snake.body[0].x == -1) {
+    if (snake.head().x == params.cell_count || snake.head().x == -1) {
         gameOver();
     }
-    if (snake.body[0].y == params.cell_count || snake.body[0].y == -1) {
+    if (snake.head().y == params.cell_count || snake.head().y == -1) {
         gameOver();
     }
 
@@ -570,10 +680,11 @@ void Game::checkCollisionWithFood() {
     it is, run the game over function.
 */
 void Game::checkCollisionWithEdges() {
-    if (snake.body[0].x >= params.cell_count || snake.body[0].x <= -1) {
+    Cell head = snake.head();
+    if (head.x >= params.cell_count || head.x <= -1) {
         gameOver();
     }
-    if (snake.body[0].y >= params.cell_count || snake.body[0].y <= -1) {
+    if (head.y >= params.cell_count || head.y <= -1) {
         gameOver();
     }
 }
@@ -597,28 +708,18 @@ void Game::checkCollisionWithEdges() {
 
     Code:
 
-    std::deque<Vector2> headless_body = snake.body;
-    headless_body.pop_front();
-
-    Explanation:
-
-    Remove the head from the body.
-
-    Code:
-
-    if (elementInDeque(snake.body[0], headless_body)) {
+    if (snake.head_collision) {
         gameOver();
     }
 
     Explanation:
 
-    If the snake's head is within the same coordinates of the snake's body,
-    run gameOver method.
+    If the snake's head is within the same coordinates of the rest of the snake's
+    body, run gameOver method. Snake::update works this out from the occupancy
+    bitboard when it moves the head.
 */
 void Game::checkCollisionWithTail() {
-    std::deque<Vector2> headless_body = snake.body;
-    headless_body.pop_front();
-    if (elementInDeque(snake.body[0], headless_body)) {
+    if (snake.head_collision) {
         gameOver();
     }
 }
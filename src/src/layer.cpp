@@ -1,8 +1,9 @@
 #include <algorithm>
 #include <iostream>
-#include <random>
 
 #include "../include/layer.h"
+#include "../include/logger.h"
+#include "../include/simd_kernels.h"
 
 /*
     Function: relu
@@ -46,7 +47,9 @@ float relu_derivative(float x) {
     Arguments:
         (int) input_size: The input size of the layer.
         (int) output_size: The output size of the layer.
-        (float) learning_rate: Learning rate of the neural network.
+        (float*) parameters: Where the layer's parameters live, parameter_count floats, zeroed and
+            aligned to MATRIX_ALIGNMENT. Part of the network's parameter buffer.
+        (Rng) rng: The generator for the initial weights.
 
     
     Returns:
@@ -56,38 +59,22 @@ float relu_derivative(float x) {
 
         Code:
 
-        weights.resize(output_size, std::vector<float>(input_size));
+        bind(parameters);
 
         Explanation:
 
-        
-                
-
-        Code:
-
-        biases.resize(output_size);
-        
-        Explanation:
-
-        The biases variable is a std::vector. Resize it to the output size.
-
-        Code:
-
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dis(-0.1, 0.1);
-
-        Explanation:
-
-        Setup random number generator.
+        The weights are held in one contiguous, cache line aligned block of the network's
+        parameter buffer. Each of the output_size rows is padded to stride floats so that every
+        row starts on an aligned boundary. The padding is zero and never read by the kernels. The
+        biases follow the weights.
 
         Code:
 
-        for (auto& row : weights) {
-                for (auto& val : row) {
-                    val = rng.dis(rng.gen);
-                }
+        for (int i = 0; i < output_size; i++) {
+            for (int j = 0; j < input_size; j++) {
+                row(i)[j] = rng.uniform(0.0f, 0.1f);
             }
+        }
 
         for (auto& val : biases) {
                 val = rng.dis(rng.gen);
@@ -98,17 +85,16 @@ float relu_derivative(float x) {
         For each weight and bias, set them to a random value.
 
 */ 
-Layer::Layer(int input_size, int output_size, float learning_rate) : learning_rate(learning_rate) {
-    weights.resize(output_size, std::vector<float>(input_size));
-    biases.resize(output_size);
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 0.1);
-
-    for (auto& row : weights) {
-        for (auto& val : row) {
-            val = dis(gen);
+Layer::Layer(int input_size, int output_size, float* parameters, Rng& rng)
+    : input_size(input_size)
+    , output_size(output_size)
+    , stride(alignedStride(input_size))
+{
+    bind(parameters);
+
+    for (int i = 0; i < output_size; i++) {
+        for (int j = 0; j < input_size; j++) {
+            row(i)[j] = rng.uniform(0.0f, 0.1f);
         }
     }
     // initialise biases to avoid dead neurons > trying to figure out cause of q values convergine to zero
@@ -117,6 +103,72 @@ Layer::Layer(int input_size, int output_size, float learning_rate) : learning_ra
     }
 }
 
+/*
+    Class: Layer
+
+    Component: Constructor
+
+    Name: Layer
+
+    Description: Constructor for a layer whose parameters already exist, such as a layer of a
+        mapped checkpoint. The layer views nothing until bind is called.
+
+    Arguments:
+        (int) input_size: The input size of the layer.
+        (int) output_size: The output size of the layer.
+    
+    Returns:
+        None
+*/ 
+Layer::Layer(int input_size, int output_size)
+    : input_size(input_size)
+    , output_size(output_size)
+    , stride(alignedStride(input_size))
+{}
+
+/*
+    Class: Layer
+
+    Component: Method
+
+    Name: parameter_count
+
+    Description: The number of floats a layer takes up in its network's parameter buffer. The
+        weights are padded row by row and the biases to a whole cache line, so that the next
+        layer's parameters start on an aligned boundary too.
+
+    Arguments:
+        (int) input_size: The input size of the layer.
+        (int) output_size: The output size of the layer.
+    
+    Returns:
+        (size_t) The number of floats, padding included.
+*/ 
+size_t Layer::parameter_count(int input_size, int output_size) {
+    return (size_t)output_size * alignedStride(input_size) + alignedStride(output_size);
+}
+
+/*
+    Class: Layer
+
+    Component: Method
+
+    Name: bind
+
+    Description: Point the weights and biases at a block of parameter_count floats. Called by
+        the network whenever its parameter buffer moves, the values are not touched.
+
+    Arguments:
+        (float*) parameters: The start of the layer's block of the parameter buffer.
+    
+    Returns:
+        None
+*/ 
+void Layer::bind(float* parameters) {
+    weights = FloatSpan(parameters, (size_t)output_size * stride);
+    biases = FloatSpan(parameters + (size_t)output_size * stride, output_size);
+}
+
 /*
     Class: Layer
 
@@ -154,12 +206,9 @@ Layer::Layer(int input_size, int output_size, float learning_rate) : learning_ra
 
         Code:
 
-        for (size_t i = 0; i < biases.size(); i++) {
-            outputs[i] = biases[i];
-            for (size_t j = 0; j < input.size(); j++) {
-                outputs[i] += weights[i][j] * input[j];
-            } outputs[i] = relu(outputs[i]);
-        }
+        outputs.assign(output_size, 0.0f);
+        gemv(weights.data(), output_size, input_size, stride, input.data(), outputs.data());
+        simdKernels().bias_relu(biases.data(), outputs.data(), output_size);
 
         Explanation:
         
@@ -167,24 +216,66 @@ Layer::Layer(int input_size, int output_size, float learning_rate) : learning_ra
         
         y = activation_function(sum(w_n * x_n) + bias).
 
-        So we iterate over each output value in the vector, add the bias.
-        Then calculate sum(w_n * x_n) and add that to each output value.
-        Finally for each output value put them through the activation 
-        function.
+        gemv calculates sum(w_n * x_n) for every row of the weight matrix. The fused
+        bias_relu kernel then adds the bias to each output value and puts it through
+        the activation function in the same pass.
 */ 
 std::vector<float> Layer::forward(const std::vector<float>& input) {
 
     inputs = input;
-    outputs.resize(biases.size());
-    for (size_t i = 0; i < biases.size(); i++) {
-        outputs[i] = biases[i];
-        for (size_t j = 0; j < input.size(); j++) {
-            outputs[i] += weights[i][j] * input[j];
-        } outputs[i] = relu(outputs[i]);
-    }
+    outputs.assign(output_size, 0.0f);
+    gemv(weights.data(), output_size, input_size, stride, input.data(), outputs.data());
+    simdKernels().bias_relu(biases.data(), outputs.data(), output_size);
     return outputs;
 }
 
+/*
+    Class: Layer
+
+    Component: Method
+
+    Name: infer
+
+    Description: Perform forward propagation for the layer without storing anything for back
+        propagation. The layer is only read, so any number of threads can call infer on the
+        same layer at once, and nothing is allocated, the caller provides the output buffer.
+
+    Arguments:
+        (const float*) input: A batch_size x input_size row-major matrix, one input per row.
+        (int) batch_size: The number of inputs.
+        (float*) output: Where to write the batch_size x output_size row-major outputs.
+    
+    Returns:
+        None
+
+    Code Explanation:
+
+        Code:
+
+        gemv(weights.data(), output_size, input_size, stride, input, output);
+
+        Explanation:
+
+        A single input uses the same matrix vector product as forward, a batch the same
+        matrix product as forward_batch, so infer gives exactly the same outputs as the
+        training forward passes. The bias and activation are then applied in place.
+*/ 
+void Layer::infer(const float* input, int batch_size, float* output) const {
+    const SimdKernels& kernels = simdKernels();
+    if (batch_size == 1) {
+        std::fill(output, output + output_size, 0.0f);
+        gemv(weights.data(), output_size, input_size, stride, input, output);
+        kernels.bias_relu(biases.data(), output, output_size);
+        return;
+    }
+
+    gemm(false, true, batch_size, output_size, input_size, 1.0f, input, input_size,
+         weights.data(), stride, 0.0f, output, output_size);
+    for (int b = 0; b < batch_size; b++) {
+        kernels.bias_relu(biases.data(), output + b * output_size, output_size);
+    }
+}
+
 /*
     Class: Layer
 
@@ -192,7 +283,8 @@ std::vector<float> Layer::forward(const std::vector<float>& input) {
 
     Name: backward
 
-    Description: Perform back propagation for the layer.
+    Description: Perform back propagation for the layer, calculating the gradients of the
+        weights and biases. The parameters are updated afterwards by apply_gradients.
 
     Arguments:
         (std::vector<float>) grad: A vector of size output_size containing the input gradients 
@@ -224,8 +316,8 @@ std::vector<float> Layer::forward(const std::vector<float>& input) {
         Code:
 
         for (size_t i = 0; i < outputs.size(); ++i) {
-            float delta = grad[i] * relu_derivative(outputs[i]);
-            ...
+            output_deltas[i] = grad[i] * relu_derivative(outputs[i]);
+        }
 
         Explanation:
 
@@ -235,66 +327,214 @@ std::vector<float> Layer::forward(const std::vector<float>& input) {
 
         Code:
 
-        for (size_t j = 0; j < inputs.size(); j++) {
-            deltas[j] += delta * weights[i][j];
+        gemvTransposed(weights.data(), output_size, input_size, stride, output_deltas.data(), deltas.data());
 
         Explanation:
 
-        Calculate the gradients for next layer, hence iteration will be size inputs.size().
-        Calculation of gradients to be passed onto next layer is
+        Calculate the gradients for next layer, hence the result has size inputs.size().
+        This uses the weights before they are updated. Calculation of gradients to be
+        passed onto next layer is
 
         dLoss / dLayerInputs = Weights transposed . grads_prev_layer
         dLoss / dLayerInputs = sum(grads_prev_layer * weights)
 
         Code:
 
-        for (size_t j = 0; j < inputs.size(); ++j)
-            weights[i][j] -= learning_rate * delta * inputs[j];
+        rankOneUpdate(weight_gradients.data(), output_size, input_size, stride, 1.0f, output_deltas.data(), inputs.data());
 
         Explanation:
 
-        Calculate the update value for each weight. This is calculated with
+        Calculate the gradient of each weight. This is calculated with
 
         dLoss / dWeights = grads_prev_layer . inputs for current layer
 
-        The learning rate controls the step size updates. The smaller the learning
-        rate the slower but smoother the convergence.
-
         Code:
 
-        biases[i] -= learning_rate * delta;
+        bias_gradients = output_deltas;
 
         Explanation:
 
-        Calculate the update values for bias, which is the following
+        Calculate the gradients of the biases, which is the following
 
         dLoss / dBiases = grads_prev_layer
 */ 
 std::vector<float> Layer::backward(const std::vector<float>& grad) {
     deltas.resize(inputs.size());
     std::fill(deltas.begin(), deltas.end(), 0.0);
+    output_deltas.resize(outputs.size());
 
     for (size_t i = 0; i < outputs.size(); i++) {
-        float delta = grad[i] * relu_derivative(outputs[i]);
-        for (size_t j = 0; j < inputs.size(); j++) {
-            deltas[j] += delta * weights[i][j];
-        } for (size_t j = 0; j < inputs.size(); j++) {
-            weights[i][j] -= learning_rate * delta * inputs[j];
-        } biases[i] -= learning_rate * delta;
-    } return deltas;
+        output_deltas[i] = grad[i] * relu_derivative(outputs[i]);
+    }
+
+    gemvTransposed(weights.data(), output_size, input_size, stride, output_deltas.data(), deltas.data());
+    weight_gradients.assign(weights.size(), 0.0f);
+    rankOneUpdate(weight_gradients.data(), output_size, input_size, stride, 1.0f, output_deltas.data(), inputs.data());
+    bias_gradients = output_deltas;
+    return deltas;
+}
+
+/*
+    Class: Layer
+
+    Component: Method
+
+    Name: forward_batch
+
+    Description: Perform forward propagation for a minibatch of inputs at once.
+
+    Arguments:
+        (std::vector<float>) input: A batch_size x input_size row-major matrix, one input per row.
+        (int) batch_size: The number of inputs in the batch.
+    
+    Returns:
+        (const std::vector<float>&) A batch_size x output_size row-major matrix of outputs. The
+            reference is to batch_outputs and is valid until the next call.
+
+    Code Explanation:
+
+        Code:
+
+        gemm(false, true, batch_size, output_size, input_size, 1.0f, input.data(), input_size,
+             weights.data(), stride, 0.0f, batch_outputs.data(), output_size);
+
+        Explanation:
+
+        One matrix multiplication calculates outputs = inputs . weights^T for the whole batch,
+        after which the fused bias_relu kernel adds the biases to each row of outputs and puts
+        them through the activation function.
+*/
+const std::vector<float>& Layer::forward_batch(const std::vector<float>& input, int batch_size) {
+    batch_inputs.assign(input.begin(), input.begin() + batch_size * input_size);
+    batch_outputs.resize(batch_size * output_size);
+
+    gemm(false, true, batch_size, output_size, input_size, 1.0f, batch_inputs.data(), input_size,
+         weights.data(), stride, 0.0f, batch_outputs.data(), output_size);
+
+    const SimdKernels& kernels = simdKernels();
+    for (int b = 0; b < batch_size; b++) {
+        kernels.bias_relu(biases.data(), batch_outputs.data() + b * output_size, output_size);
+    }
+    return batch_outputs;
+}
+
+/*
+    Class: Layer
+
+    Component: Method
+
+    Name: backward_batch
+
+    Description: Perform back propagation for the minibatch given to the last forward_batch call.
+        Gradients are accumulated over the whole batch and a single update is applied to the
+        weights and biases.
+
+    Arguments:
+        (std::vector<float>) grad: A batch_size x output_size row-major matrix of input gradients.
+        (int) batch_size: The number of samples in the batch.
+    
+    Returns:
+        (const std::vector<float>&) A batch_size x input_size row-major matrix containing the
+            gradients for the next layer. The reference is to batch_deltas.
+
+    Code Explanation:
+
+        Code:
+
+        gemm(false, false, batch_size, input_size, output_size, 1.0f, batch_output_deltas.data(), output_size,
+             weights.data(), stride, 0.0f, batch_deltas.data(), input_size);
+
+        Explanation:
+
+        Gradients for the next layer, dLoss / dLayerInputs = grads_prev_layer . Weights, calculated
+        with the weights before they are updated.
+
+        Code:
+
+        gemm(true, false, output_size, input_size, batch_size, 1.0f, batch_output_deltas.data(), output_size,
+             batch_inputs.data(), input_size, 0.0f, weight_gradients.data(), stride);
+
+        Explanation:
+
+        Weight gradients, dLoss / dWeights = grads_prev_layer^T . inputs, which sums the gradient of
+        every sample in the batch. The sum rather than the mean is used so that one minibatch update
+        has the same scale as the per sample updates of backward with the same learning rate.
+
+        The parameters are updated afterwards by apply_gradients.
+*/
+const std::vector<float>& Layer::backward_batch(const std::vector<float>& grad, int batch_size) {
+    batch_output_deltas.resize(batch_size * output_size);
+    for (int i = 0; i < batch_size * output_size; i++) {
+        batch_output_deltas[i] = grad[i] * relu_derivative(batch_outputs[i]);
+    }
+
+    batch_deltas.resize(batch_size * input_size);
+    gemm(false, false, batch_size, input_size, output_size, 1.0f, batch_output_deltas.data(), output_size,
+         weights.data(), stride, 0.0f, batch_deltas.data(), input_size);
+
+    weight_gradients.resize(weights.size());
+    gemm(true, false, output_size, input_size, batch_size, 1.0f, batch_output_deltas.data(), output_size,
+         batch_inputs.data(), input_size, 0.0f, weight_gradients.data(), stride);
+
+    bias_gradients.assign(output_size, 0.0f);
+    for (int b = 0; b < batch_size; b++) {
+        for (int i = 0; i < output_size; i++) {
+            bias_gradients[i] += batch_output_deltas[b * output_size + i];
+        }
+    }
+
+    return batch_deltas;
+}
+
+/*
+    Class: Layer
+
+    Component: Method
+
+    Name: apply_gradients
+
+    Description: Update the weights and biases from the gradients of the last backward or
+        backward_batch call.
+
+    Arguments:
+        (Optimiser) optimiser: The update rule, begin_step must have been called for this step.
+    
+    Returns:
+        None
+
+    Code Explanation:
+
+        Code:
+
+        weight_moments.resize(optimiser.moment_count() * weights.size());
+
+        Explanation:
+
+        The moment buffers are allocated, zeroed, on the first update. They share the layout of
+        the weights, padding included, so the padding has zero gradient and zero moments and the
+        whole buffer can be updated in one pass of the optimiser's fused kernel.
+*/
+void Layer::apply_gradients(const Optimiser& optimiser) {
+    weight_moments.resize(optimiser.moment_count() * weights.size());
+    bias_moments.resize(optimiser.moment_count() * output_size);
+    optimiser.update(weights.data(), weight_gradients.data(), weight_moments.data(), weights.size());
+    optimiser.update(biases.data(), bias_gradients.data(), bias_moments.data(), output_size);
 }
 
 void Layer::load_in_params(std::vector<std::vector<float>>& loaded_weights, std::vector<float>& loaded_biases) {
 
-    if (loaded_weights.size() != weights.size() || loaded_biases.size() != biases.size()) {
-        std::cout << loaded_weights.size() << std::endl;
-        std::cout << weights.size() << std::endl;
-        std::cout << loaded_biases.size() << std::endl;
-        std::cout << biases.size() << std::endl;
+    if (loaded_weights.size() != (size_t)output_size || loaded_biases.size() != biases.size()) {
+        LOG_ERROR("loaded weight rows: " << loaded_weights.size() << " ::: layer outputs: " << output_size
+                  << " ::: loaded biases: " << loaded_biases.size() << " ::: layer biases: " << biases.size());
         throw std::runtime_error("Mismatch in layer dimensions and loaded parameters");
     }
 
-    weights = loaded_weights;
-    biases = loaded_biases;
+    for (int i = 0; i < output_size; i++) {
+        if (loaded_weights[i].size() != (size_t)input_size) {
+            throw std::runtime_error("Mismatch in layer dimensions and loaded parameters");
+        }
+        std::copy(loaded_weights[i].begin(), loaded_weights[i].end(), row(i));
+    }
+    std::copy(loaded_biases.begin(), loaded_biases.end(), biases.begin());
 }
 
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <iostream>
+
+#include "../include/logger.h"
+
+const char* const LOG_LEVEL_NAMES[] = {"trace", "debug", "info", "warn", "error"};
+
+// Nanoseconds on the steady clock.
+static int64_t logClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+    Function: logger
+
+    Description: The process wide logger which the LOG_ macros write through.
+
+    Arguments:
+        None
+
+    Returns:
+        (Logger&) The logger.
+*/
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+/*
+    Class: Logger
+
+    Component: Constructor
+
+    Name: Logger
+
+    Description: Write info and above to standard output.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+Logger::Logger()
+    : level(LOG_LEVEL_INFO)
+    , out(&std::cout)
+{}
+
+/*
+    Class: Logger
+
+    Component: Method
+
+    Name: write
+
+    Description: Write one message on its own line, prefixed with its level. Messages from
+        different threads never interleave. Warnings and errors are flushed straight away, the
+        rest are left to the stream's buffering.
+
+    Arguments:
+        (LogLevel) message_level: The level of the message.
+        (std::string) message: The formatted message.
+
+    Returns:
+        None
+*/
+void Logger::write(LogLevel message_level, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    *out << "[" << LOG_LEVEL_NAMES[message_level] << "] " << message << '\n';
+    if (message_level >= LOG_LEVEL_WARN) {
+        out->flush();
+    }
+}
+
+/*
+    Class: LogRateLimiter
+
+    Component: Constructor
+
+    Name: LogRateLimiter
+
+    Description: Allow the first message straight away, then one per interval.
+
+    Arguments:
+        (double) interval_seconds: The minimum time between messages.
+
+    Returns:
+        None
+*/
+LogRateLimiter::LogRateLimiter(double interval_seconds)
+    : interval((int64_t)(interval_seconds * 1e9))
+    , next_time(0)
+    , suppressed_count(0)
+{}
+
+/*
+    Class: LogRateLimiter
+
+    Component: Method
+
+    Name: allow
+
+    Description: Check whether a message may be written now. If not it is counted as suppressed.
+
+    Arguments:
+        (uint64_t) suppressed: Set, when allowed, to the number of messages suppressed since the
+            last one allowed.
+
+    Returns:
+        (bool) True if the message should be written.
+
+    Code Explanation:
+
+    Code:
+
+    if (!next_time.compare_exchange_strong(next, now + interval, std::memory_order_relaxed)) {
+
+    Explanation:
+
+    When the interval is up on several threads at once only the one which moves next_time on
+    writes its message, the others count as suppressed.
+*/
+bool LogRateLimiter::allow(uint64_t& suppressed) {
+    int64_t now = logClock();
+    int64_t next = next_time.load(std::memory_order_relaxed);
+    if (now < next || !next_time.compare_exchange_strong(next, now + interval, std::memory_order_relaxed)) {
+        suppressed_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = suppressed_count.exchange(0, std::memory_order_relaxed);
+    return true;
+}
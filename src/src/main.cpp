@@ -1,10 +1,19 @@
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <memory>
 
+#include "../include/actor_learner.h"
+#include "../include/checkpoint.h"
 #include "../include/dqn.h"
+#include "../include/environment.h"
 #include "../include/game.h"
 #include "../include/game_params.h"
 #include "../include/file_reader.h"
+#include "../include/logger.h"
+#include "../include/profiler.h"
+#include "../include/reward.h"
+#include "../include/trace_writer.h"
 
 int main() {
 
@@ -12,11 +21,18 @@ int main() {
 	GameParams game_params;
 	NetworkParams network_params;
 	int action;
+	logger().level = network_params.LOG_LEVEL;
+
+	// Headless mode only applies to training, the test mode always needs a window to watch the agent.
+	bool headless = network_params.train_mode && network_params.headless_mode;
 
 	// Total window size includes two border regions (the offset) and game region (cell_size / cell_count).
-	// See game_params.h for values.
-	InitWindow(game_params.game_window_height, game_params.game_window_width, game_params.game_title);
-	SetTargetFPS(game_params.frame_rate);
+	// See game_params.h for values. In headless mode no window is opened and the frame rate is not capped,
+	// so the game steps as fast as the CPU allows.
+	if (!headless) {
+		InitWindow(game_params.game_window_height, game_params.game_window_width, game_params.game_title);
+		SetTargetFPS(game_params.frame_rate);
+	}
 
 	// Create game object, with game active to false, score to zero, passing the game configuration
 	// and the last update time to zero.
@@ -24,53 +40,35 @@ int main() {
 
 	// Create dep q network object, with input size 10, being the state size, 4 the output size, representing
 	// the 4 output q values representing the 4 actions, 10000 memory capacity and parameters of the deep q network.	
-	DQN dqn = DQN(10, 4, network_params.MEMORY_CAPACITY, network_params);
-
-	// Initialise actions
-	enum Actions { UP, DOWN, LEFT, RIGHT };
+	DQN dqn = DQN(STATE_SIZE, ACTION_SIZE, network_params.MEMORY_CAPACITY, network_params);
 
-	// If training mode turned off load in some pre trained weights.
+	// If training mode turned off load in some pre trained weights. A binary checkpoint is mapped and
+	// used in place by the policy network, it has to stay mapped for as long as the network is used.
+	std::unique_ptr<MappedCheckpoint> checkpoint;
 	if (network_params.train_mode == false) {
-		std::vector<std::vector<std::vector<float>>> loaded_weights = read_in_weights(network_params.weights_filepath);
-		std::vector<std::vector<float>> loaded_biases = read_in_biases(network_params.biases_filepath);
-		dqn.policy_net.load_in_network_params(loaded_weights, loaded_biases);
+		if (std::ifstream(network_params.checkpoint_filepath).good()) {
+			checkpoint.reset(new MappedCheckpoint(network_params.checkpoint_filepath));
+			dqn.policy_net = checkpoint->network;
+			dqn.action_workspace = NeuralNetwork::Workspace(dqn.policy_net, 1);
+		} else {
+			std::vector<std::vector<std::vector<float>>> loaded_weights = read_in_weights(network_params.weights_filepath);
+			std::vector<std::vector<float>> loaded_biases = read_in_biases(network_params.biases_filepath);
+			dqn.policy_net.load_in_network_params(loaded_weights, loaded_biases);
+		}
+		StateEncoder encoder(game_params);
+		std::vector<float> state(STATE_SIZE);
 		while (WindowShouldClose() == false) {
 
 			BeginDrawing();
 
 			// Get state and decide action.
-			std::vector<float> state = getState(game.snake, game.food);
+			encoder.encode(game.snake, game.food, state.data());
 
 
-			int action = dqn.selectActionTest(state, dqn.policy_net);
+			int action = dqn.selectActionTest(state.data());
 
 			// Implement action from generated action value.
-			switch(action) {
-				case UP:
-					if (game.snake.direction.y != 1) {
-						game.snake.direction = {0, -1};
-						game.game_running = true;
-					}
-					break;
-				case DOWN:
-					if (game.snake.direction.y != -1) {
-						game.snake.direction = {0, 1};
-						game.game_running = true;
-					}
-					break;
-				case LEFT:
-					if (game.snake.direction.x != 1) {
-						game.snake.direction = {-1, 0};
-						game.game_running = true;
-					}
-					break;
-				case RIGHT:
-					if (game.snake.direction.x != -1) {
-						game.snake.direction = {1, 0};
-						game.game_running = true;
-					}
-					break;
-			}
+			applyAction(game, action);
 
 			game.snake.update();
 
@@ -86,26 +84,130 @@ int main() {
 	
 	// If training mode turned on, train the agent.
 	if (network_params.train_mode == true) {
-		// Initialise epsiode number.
+		// Initialise epsiode number. Note episode counts the environment steps, whilst games_played counts
+		// the number of terminal states reached.
 		int episode = 0;
+		int games_played = 0;
+		auto training_start = std::chrono::steady_clock::now();
+		profiler().reset();
 
-		// Open files.
-		std::ofstream outFile1("q_values.txt");
+		// Open files. Training steps are traced to a binary file by a background thread, see
+		// trace_writer.h and tools/trace_decoder.cpp.
+		TraceWriter trace(network_params.trace_filepath, network_params.TRACE_BUFFER_CAPACITY, network_params.TRACE_INTERVAL);
 		std::ofstream outFile2("weights.txt");
 		std::ofstream outFile3("biases.txt");
 
+		// Headless runs stop once the configured step or game budget is used up. A limit of zero means
+		// no limit on that count.
+		auto trainingBudgetRemaining = [&]() {
+			if (network_params.HEADLESS_MAX_STEPS > 0 && episode >= network_params.HEADLESS_MAX_STEPS) return false;
+			if (network_params.HEADLESS_MAX_EPISODES > 0 && games_played >= network_params.HEADLESS_MAX_EPISODES) return false;
+			return true;
+		};
+
+		// Headless training with actor threads:
+		// NUM_ACTORS threads step their own games and send the experiences to this thread, which
+		// trains and publishes the new weights back to them, see actor_learner.h. The learner only
+		// receives the transitions, not the games, so these runs are not traced.
+		if (headless && network_params.NUM_ACTORS > 0) {
+			if (network_params.TRACE_INTERVAL > 0) {
+				LOG_WARN("training with actor threads is not traced, " << network_params.trace_filepath << " will have no records");
+			}
+			ActorLearner actor_learner(dqn, game_params, network_params);
+			actor_learner.run();
+			episode = actor_learner.steps;
+			games_played = actor_learner.games_played;
+		}
+
+		// Headless training loop:
+		// Step NUM_ENVIRONMENTS games in lockstep until the training budget is used up. Every lockstep
+		// iteration stores one experience per game and performs one training step, so episode advances
+		// by the number of games each iteration. The actions of all the games come from one batched pass
+		// through the policy network, see DQN::selectActionsTrain. Game i takes step episode + i, and
+		// the games whose steps are sampled by the trace interval are traced as in the game loop below.
+		else if (headless) {
+			VectorEnvironment environment(network_params.NUM_ENVIRONMENTS, game_params, network_params);
+			std::vector<int> actions(environment.num_envs);
+			std::vector<int> traced_envs;
+			std::vector<TraceRecord> records;
+			int iteration = 0;
+
+			while (trainingBudgetRemaining()) {
+				PROFILE_BEGIN(select_timer, PHASE_SELECT_ACTION);
+				dqn.selectActionsTrain(environment.states.data(), environment.num_envs, episode, actions.data());
+				PROFILE_END(select_timer);
+
+				environment.step(actions);
+
+				PROFILE_BEGIN(logging_timer, PHASE_LOGGING);
+				traced_envs.clear();
+				records.clear();
+				for (int i = 0; i < environment.num_envs; i++) {
+					if (!trace.sampled(episode + i)) continue;
+					const Game& traced_game = environment.games[i];
+					const float* q_values = dqn.qValues(environment.previousState(i));
+					TraceRecord record = {};
+					record.step = episode + i;
+					record.action = actions[i];
+					record.reward = environment.rewards[i];
+					record.head_x = traced_game.snake.head().x;
+					record.head_y = traced_game.snake.head().y;
+					record.food_x = traced_game.food.position.x;
+					record.food_y = traced_game.food.position.y;
+					record.done = environment.dones[i];
+					std::copy(q_values, q_values + ACTION_SIZE, record.q_values);
+					traced_envs.push_back(i);
+					records.push_back(record);
+				}
+				PROFILE_END(logging_timer);
+
+				PROFILE_BEGIN(store_timer, PHASE_STORE_EXPERIENCE);
+				for (int i = 0; i < environment.num_envs; i++) {
+					dqn.replay_memory.storeExperience(environment.previousState(i), actions[i], environment.rewards[i],
+													  environment.state(i), environment.dones[i]);
+					if (environment.dones[i]) {
+						games_played++;
+					}
+				}
+				PROFILE_END(store_timer);
+
+				if (iteration % network_params.TARGET_UPDATE == 0) {
+					PROFILE_SCOPE(PHASE_TARGET_UPDATE);
+					dqn.updateTargetNet();
+				}
+
+				dqn.train(network_params.BATCH_SIZE);
+
+				PROFILE_BEGIN(check_timer, PHASE_LOGGING);
+				for (size_t r = 0; r < records.size(); r++) {
+					const float* new_q_values = dqn.qValues(environment.previousState(traced_envs[r]));
+					std::copy(new_q_values, new_q_values + ACTION_SIZE, records[r].q_values_after);
+					trace.record(records[r]);
+				}
+				PROFILE_END(check_timer);
+
+				episode += environment.num_envs;
+				iteration++;
+			}
+		}
+
+		// The next state of one step is the state of the following step, so the state is only
+		// encoded once per step, after the game has moved.
+		StateEncoder encoder(game_params);
+		RewardEngine reward_engine(network_params, game_params);
+		std::vector<float> state(STATE_SIZE);
+		std::vector<float> next_state(STATE_SIZE);
+		encoder.encode(game.snake, game.food, state.data());
+
 		// Game loop:
 		// Check is the esc key pressed to close the window.
-		while (WindowShouldClose() == false) {
+		while (!headless && WindowShouldClose() == false) {
 
 			BeginDrawing();
 
-			// Get state and decide action.
-			std::vector<float> state = getState(game.snake, game.food);
-
 			// Get previous snake head position to calculate if have moved towards
 			// or away from food.
-			Vector2 previous_snake_head_pos = game.snake.body[0];
+			Cell previous_snake_head_pos = game.snake.head();
 
 			// if (IsKeyPressed(KEY_UP) && game.snake.direction.y != 1) {
 			// 	int action = 0;
@@ -129,79 +231,74 @@ int main() {
 			// }
 
 			// Select action
-			int action = dqn.selectActionTrain(state, dqn.policy_net, episode);
+			PROFILE_BEGIN(select_timer, PHASE_SELECT_ACTION);
+			int action = dqn.selectActionTrain(state.data(), episode);
+			PROFILE_END(select_timer);
 			
 
 			// Implement action from generated action value.
-			switch(action) {
-				case UP:
-					if (game.snake.direction.y != 1) {
-						game.snake.direction = {0, -1};
-						game.game_running = true;
-					}
-					break;
-				case DOWN:
-					if (game.snake.direction.y != -1) {
-						game.snake.direction = {0, 1};
-						game.game_running = true;
-					}
-					break;
-				case LEFT:
-					if (game.snake.direction.x != 1) {
-						game.snake.direction = {-1, 0};
-						game.game_running = true;
-					}
-					break;
-				case RIGHT:
-					if (game.snake.direction.x != -1) {
-						game.snake.direction = {1, 0};
-						game.game_running = true;
-					}
-					break;
-			}
+			PROFILE_BEGIN(update_timer, PHASE_SNAKE_UPDATE);
+			applyAction(game, action);
 
 			// Update snake position
 			game.snake.update();
-			
+			PROFILE_END(update_timer);
+
 			// Get the reward from action being done.
-			float reward = getReward(game.snake, game.food, previous_snake_head_pos);
+			PROFILE_BEGIN(reward_timer, PHASE_REWARD);
+			float reward = reward_engine.reward(game.snake, game.food, previous_snake_head_pos);
+			PROFILE_END(reward_timer);
 
 			// Check collisions
+			PROFILE_BEGIN(collision_timer, PHASE_COLLISIONS);
 			game.checkCollisions();
+			PROFILE_END(collision_timer);
 
 			// Get next state.
-			std::vector<float> next_state = getState(game.snake, game.food);
-
-			// Calculate q values to store.
-			std::vector<float> q_values = dqn.policy_net.forward(state);
-			
-			// Output data.
-			outFile1 << "-----------" << std::endl;
-			outFile1 << "snake head x " << game.snake.body[0].x << std::endl;
-			outFile1 << "snake head y " << game.snake.body[0].y << std::endl;
-			outFile1 << "food position x " << game.food.position.x << std::endl;
-			outFile1 << "food position y " << game.food.position.y << std::endl;
-			outFile1 << "action " << action << std::endl;
-			outFile1 << "reward " << reward << std::endl;
-			outFile1 << "Q values original" << std::endl;
-
-			for (const auto& value : q_values) {
-				outFile1 << value << std::endl;  // Write each value followed by a newline
+			PROFILE_BEGIN(encode_timer, PHASE_ENCODE_STATE);
+			encoder.encode(game.snake, game.food, next_state.data());
+			PROFILE_END(encode_timer);
+
+			// Output data. Only the steps sampled by the trace interval are recorded, the Q values
+			// are not even calculated for the rest.
+			PROFILE_BEGIN(logging_timer, PHASE_LOGGING);
+			bool traced = trace.sampled(episode);
+			TraceRecord record = {};
+			if (traced) {
+				const float* q_values = dqn.qValues(state.data());
+				record.step = episode;
+				record.action = action;
+				record.reward = reward;
+				record.head_x = game.snake.head().x;
+				record.head_y = game.snake.head().y;
+				record.food_x = game.food.position.x;
+				record.food_y = game.food.position.y;
+				record.done = !game.game_running;
+				std::copy(q_values, q_values + ACTION_SIZE, record.q_values);
 			}
+			PROFILE_END(logging_timer);
 
 			// Decide if a terminal state has been reached. 
 			// ! inversion operator for bools, that is if the game is running, then
 			// game is done and vice versa.
 			bool done = !game.game_running;
+			if (done) {
+				games_played++;
+			}
+			PROFILE_COUNT(COUNTER_ENV_STEPS, 1);
+			PROFILE_COUNT(COUNTER_GAMES, done);
 
+			PROFILE_BEGIN(store_timer, PHASE_STORE_EXPERIENCE);
 			ReplayMemory::Experience experience = {state, action, reward, next_state, done};
 
 			// Store experience
 			dqn.replay_memory.storeExperience(experience);
+			PROFILE_END(store_timer);
 
 			// If episode has reached update threshold, update the target neural network with 
 			// policy network's current values.
 			if (episode % network_params.TARGET_UPDATE == 0) {
+				PROFILE_SCOPE(PHASE_TARGET_UPDATE);
 				dqn.updateTargetNet();
 			}
 
@@ -209,34 +306,47 @@ int main() {
 			dqn.train(network_params.BATCH_SIZE);
 
 			// Check if Q values have been updated.
-			outFile1 << "Q values after training >> should be updated" << std::endl;
-			std::vector<float> new_q_values = dqn.policy_net.forward(state);
-
-			for (const auto& value : new_q_values) {
-				outFile1 << value << std::endl;  // Write each value followed by a newline
+			PROFILE_BEGIN(check_timer, PHASE_LOGGING);
+			if (traced) {
+				const float* new_q_values = dqn.qValues(state.data());
+				std::copy(new_q_values, new_q_values + ACTION_SIZE, record.q_values_after);
+				trace.record(record);
 			}
 
-			std::cout << "episode: " << episode << std::endl;
-			std::cout << "action: " << action << " ::: reward:" << reward << std::endl;
+			LOG_TRACE("episode: " << episode << " ::: action: " << action << " ::: reward: " << reward);
+			LOG_INFO_EVERY(5.0, "episode: " << episode << " ::: games: " << games_played << " ::: score: " << game.score);
+			PROFILE_END(check_timer);
 
 			// Drawing the background graphics
+			PROFILE_BEGIN(draw_timer, PHASE_DRAW);
 			ClearBackground(game_params.green);
 			DrawRectangleLinesEx(Rectangle{(float)game_params.offset-5, (float)game_params.offset-5, (float)game_params.cell_size * game_params.cell_count + 10, (float)game_params.cell_size * game_params.cell_count + 10}, 5, game_params.dark_green);
 			DrawText("Retro Snake", game_params.offset - 5, 20, 40, game_params.dark_green);
 			DrawText(TextFormat("%i", game.score), game_params.offset - 5, game_params.offset + game_params.cell_size * game_params.cell_count + 10, 40, game_params.dark_green);
 			game.draw();
 			EndDrawing();
+			PROFILE_END(draw_timer);
 
+			state.swap(next_state);
 			episode++;
 		}
 
+		// Report the training throughput.
+		double training_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - training_start).count();
+		LOG_INFO("steps: " << episode << " ::: games: " << games_played << " ::: seconds: " << training_seconds
+				 << " ::: steps/sec: " << (training_seconds > 0 ? episode / training_seconds : 0));
+#ifdef ENABLE_PROFILING
+		profiler().printSummary(std::cout);
+		profiler().writeReport(network_params.profile_filepath);
+#endif
+
 		// output the weights
 		for (auto& layer : dqn.policy_net.layers) {
 			outFile2 << "layer" << std::endl;
-			for (auto& row : layer.weights) {
+			for (int i = 0; i < layer.output_size; i++) {
 				outFile2 << "row " << std::endl;
-				for (auto& weight : row) {
-					outFile2 << weight << " ";
+				for (int j = 0; j < layer.input_size; j++) {
+					outFile2 << layer.row(i)[j] << " ";
 				} outFile2 << std::endl;
 			}
 
@@ -249,9 +359,18 @@ int main() {
 		// // Close the files
 		outFile2.close();
 		outFile3.close();
-		outFile1.close();
+		trace.close();
+		if (trace.dropped > 0) {
+			LOG_WARN("trace records dropped: " << trace.dropped);
+		}
+
+		// Save the policy network as a binary checkpoint too, it loads back exactly and can be mapped
+		// in test mode, see checkpoint_filepath.
+		saveCheckpoint("checkpoint.bin", dqn.policy_net);
 	}
 
-	CloseWindow();
+	if (!headless) {
+		CloseWindow();
+	}
 	return 0;
 }
\ No newline at end of file
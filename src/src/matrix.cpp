@@ -0,0 +1,238 @@
+#include <algorithm>
+
+#include "../include/matrix.h"
+#include "../include/simd_kernels.h"
+
+// Tile sizes for gemm. A K x N tile of B (128 x 256 floats, 128KB) stays in L2 whilst it is reused
+// for every row of the M tile.
+const int GEMM_BLOCK_M = 64;
+const int GEMM_BLOCK_N = 256;
+const int GEMM_BLOCK_K = 128;
+
+/*
+    Function: alignedStride
+
+    Description: Round a row length up so that every row of a row-major matrix starts on a
+        MATRIX_ALIGNMENT boundary.
+
+    Arguments:
+        (int) cols: The number of columns of the matrix.
+
+    Returns:
+        (int) The row stride in floats, at least cols.
+*/
+int alignedStride(int cols) {
+    int floats_per_line = MATRIX_ALIGNMENT / sizeof(float);
+    return (cols + floats_per_line - 1) / floats_per_line * floats_per_line;
+}
+
+/*
+    Function: gemv
+
+    Description: Matrix vector product accumulated into y, that is y += A . x. A is rows x cols
+        stored row-major with a row stride of lda floats.
+
+    Arguments:
+        (const float*) a: The matrix.
+        (int) rows: Number of rows of the matrix, the size of y.
+        (int) cols: Number of columns of the matrix, the size of x.
+        (int) lda: Row stride of the matrix.
+        (const float*) x: The input vector.
+        (float*) y: The output vector, which holds the values to accumulate onto.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    for (; i + 4 <= rows; i += 4) {
+
+    Explanation:
+
+    Process four rows at a time so that every load of x is reused four times and the four
+    sums can be computed independently of each other. The dot products run on the vector
+    kernels selected for this CPU, see simd_kernels.h.
+*/
+void gemv(const float* a, int rows, int cols, int lda, const float* x, float* y) {
+    const SimdKernels& kernels = simdKernels();
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const float* a0 = a + i * lda;
+        float sums[4];
+        kernels.dot4(x, a0, a0 + lda, a0 + 2 * lda, a0 + 3 * lda, cols, sums);
+        y[i] += sums[0];
+        y[i + 1] += sums[1];
+        y[i + 2] += sums[2];
+        y[i + 3] += sums[3];
+    }
+    for (; i < rows; i++) {
+        y[i] += kernels.dot(a + i * lda, x, cols);
+    }
+}
+
+/*
+    Function: gemvTransposed
+
+    Description: Transposed matrix vector product accumulated into y, that is y += A^T . x.
+        A is rows x cols stored row-major, hence x has size rows and y has size cols. The rows
+        are walked in order so the matrix is read contiguously.
+
+    Arguments:
+        (const float*) a: The matrix.
+        (int) rows: Number of rows of the matrix, the size of x.
+        (int) cols: Number of columns of the matrix, the size of y.
+        (int) lda: Row stride of the matrix.
+        (const float*) x: The input vector.
+        (float*) y: The output vector, which holds the values to accumulate onto.
+
+    Returns:
+        None
+*/
+void gemvTransposed(const float* a, int rows, int cols, int lda, const float* x, float* y) {
+    const SimdKernels& kernels = simdKernels();
+    for (int i = 0; i < rows; i++) {
+        kernels.axpy(x[i], a + i * lda, y, cols);
+    }
+}
+
+/*
+    Function: rankOneUpdate
+
+    Description: Add the scaled outer product of two vectors to a matrix, that is
+        A += alpha * x . y^T. Used for the gradient descent step of a single sample, where x is
+        the layer deltas and y the layer inputs.
+
+    Arguments:
+        (float*) a: The matrix to update.
+        (int) rows: Number of rows of the matrix, the size of x.
+        (int) cols: Number of columns of the matrix, the size of y.
+        (int) lda: Row stride of the matrix.
+        (float) alpha: The scale, the negative learning rate for gradient descent.
+        (const float*) x: The column vector.
+        (const float*) y: The row vector.
+
+    Returns:
+        None
+*/
+void rankOneUpdate(float* a, int rows, int cols, int lda, float alpha, const float* x, const float* y) {
+    const SimdKernels& kernels = simdKernels();
+    for (int i = 0; i < rows; i++) {
+        kernels.axpy(alpha * x[i], y, a + i * lda, cols);
+    }
+}
+
+/*
+    Function: gemmBlocked
+
+    Description: Cache blocked matrix multiplication for one combination of transposes, see gemm.
+        When B is not transposed the inner loop runs along a row of B and C (an axpy), otherwise
+        it runs along a row of B as a dot product, four rows of B at a time. Either way the innermost
+        loop is contiguous and runs on the vector kernels, apart from the dot products when A is
+        also transposed, which are strided in A and stay scalar.
+*/
+template <bool TRANSPOSE_A, bool TRANSPOSE_B>
+static void gemmBlocked(int m, int n, int k, float alpha, const float* a, int lda, const float* b, int ldb, float* c, int ldc) {
+    const SimdKernels& kernels = simdKernels();
+    for (int i0 = 0; i0 < m; i0 += GEMM_BLOCK_M) {
+        int i_end = std::min(i0 + GEMM_BLOCK_M, m);
+        for (int j0 = 0; j0 < n; j0 += GEMM_BLOCK_N) {
+            int j_end = std::min(j0 + GEMM_BLOCK_N, n);
+            for (int p0 = 0; p0 < k; p0 += GEMM_BLOCK_K) {
+                int p_end = std::min(p0 + GEMM_BLOCK_K, k);
+
+                for (int i = i0; i < i_end; i++) {
+                    float* c_row = c + i * ldc;
+                    if (!TRANSPOSE_B) {
+                        for (int p = p0; p < p_end; p++) {
+                            float a_ip = alpha * (TRANSPOSE_A ? a[p * lda + i] : a[i * lda + p]);
+                            kernels.axpy(a_ip, b + p * ldb + j0, c_row + j0, j_end - j0);
+                        }
+                    } else {
+                        int j = j0;
+                        if (!TRANSPOSE_A) {
+                            const float* a_row = a + i * lda + p0;
+                            for (; j + 4 <= j_end; j += 4) {
+                                const float* b0 = b + j * ldb + p0;
+                                float sums[4];
+                                kernels.dot4(a_row, b0, b0 + ldb, b0 + 2 * ldb, b0 + 3 * ldb, p_end - p0, sums);
+                                c_row[j] += alpha * sums[0];
+                                c_row[j + 1] += alpha * sums[1];
+                                c_row[j + 2] += alpha * sums[2];
+                                c_row[j + 3] += alpha * sums[3];
+                            }
+                        }
+                        for (; j + 4 <= j_end; j += 4) {
+                            const float* b0 = b + j * ldb;
+                            const float* b1 = b0 + ldb;
+                            const float* b2 = b1 + ldb;
+                            const float* b3 = b2 + ldb;
+                            float sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+                            for (int p = p0; p < p_end; p++) {
+                                float a_ip = TRANSPOSE_A ? a[p * lda + i] : a[i * lda + p];
+                                sum0 += a_ip * b0[p];
+                                sum1 += a_ip * b1[p];
+                                sum2 += a_ip * b2[p];
+                                sum3 += a_ip * b3[p];
+                            }
+                            c_row[j] += alpha * sum0;
+                            c_row[j + 1] += alpha * sum1;
+                            c_row[j + 2] += alpha * sum2;
+                            c_row[j + 3] += alpha * sum3;
+                        }
+                        for (; j < j_end; j++) {
+                            const float* b_row = b + j * ldb;
+                            float sum = 0;
+                            for (int p = p0; p < p_end; p++) {
+                                sum += (TRANSPOSE_A ? a[p * lda + i] : a[i * lda + p]) * b_row[p];
+                            }
+                            c_row[j] += alpha * sum;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+    Function: gemm
+
+    Description: General matrix multiplication C = alpha * op(A) . op(B) + beta * C, with all
+        matrices row-major. op(A) is m x k, op(B) is k x n and C is m x n. This follows the
+        argument order of BLAS sgemm so it can be swapped for a BLAS library later.
+
+    Arguments:
+        (bool) transpose_a: Use A^T instead of A.
+        (bool) transpose_b: Use B^T instead of B.
+        (int) m: Rows of op(A) and C.
+        (int) n: Columns of op(B) and C.
+        (int) k: Columns of op(A) and rows of op(B).
+        (float) alpha: Scale of the product.
+        (const float*) a: Matrix A, with row stride lda.
+        (const float*) b: Matrix B, with row stride ldb.
+        (float) beta: Scale of the existing values of C, zero to overwrite C.
+        (float*) c: Matrix C, with row stride ldc.
+
+    Returns:
+        None
+*/
+void gemm(bool transpose_a, bool transpose_b, int m, int n, int k, float alpha,
+          const float* a, int lda, const float* b, int ldb, float beta, float* c, int ldc) {
+    for (int i = 0; i < m; i++) {
+        float* c_row = c + i * ldc;
+        if (beta == 0) {
+            std::fill(c_row, c_row + n, 0.0f);
+        } else if (beta != 1) {
+            for (int j = 0; j < n; j++) {
+                c_row[j] *= beta;
+            }
+        }
+    }
+
+    if (!transpose_a && !transpose_b) gemmBlocked<false, false>(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    else if (!transpose_a && transpose_b) gemmBlocked<false, true>(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    else if (transpose_a && !transpose_b) gemmBlocked<true, false>(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    else gemmBlocked<true, true>(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+}
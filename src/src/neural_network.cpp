@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <string>
+
+#include "../include/logger.h"
 #include "../include/neural_network.h"
+#include "../include/simd_kernels.h"
 
 /*
     Class: NeuralNetwork
@@ -7,7 +12,8 @@
 
     Name: NeuralNetwork
 
-    Description: Set the neural network parameters.
+    Description: Set the neural network parameters. The network is trained with plain stochastic
+        gradient descent unless another optimiser is assigned.
 
     Arguments:
         (double) learning_rate: Neural network learning rate.
@@ -15,7 +21,69 @@
     Returns:
         None
 */ 
-NeuralNetwork::NeuralNetwork(float learning_rate) : learning_rate(learning_rate) {};
+NeuralNetwork::NeuralNetwork(float learning_rate) : mapped_parameters(nullptr), optimiser(learning_rate) {};
+
+/*
+    Class: NeuralNetwork
+
+    Component: Constructor
+
+    Name: NeuralNetwork
+
+    Description: Copy a network, parameters, layer buffers and optimiser state included.
+
+    Arguments:
+        (NeuralNetwork) other: The network to copy.
+    
+    Returns:
+        None
+
+    Code Explanation:
+
+        Code:
+
+        bind_layers();
+
+        Explanation:
+
+        The copied layers still view the other network's parameter buffer, point them at this
+        network's copy. Moving a network needs no rebinding, the moved buffer keeps its address.
+        A copy of a network viewing a mapped checkpoint views the same mapping.
+*/ 
+NeuralNetwork::NeuralNetwork(const NeuralNetwork& other)
+    : parameters(other.parameters)
+    , mapped_parameters(other.mapped_parameters)
+    , layers(other.layers)
+    , optimiser(other.optimiser)
+{
+    bind_layers();
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: operator=
+
+    Description: Copy a network into this one, parameters, layer buffers and optimiser state
+        included. To copy only the parameters between networks of the same shape, use
+        copy_parameters.
+
+    Arguments:
+        (NeuralNetwork) other: The network to copy.
+    
+    Returns:
+        (NeuralNetwork&) This network.
+*/ 
+NeuralNetwork& NeuralNetwork::operator=(const NeuralNetwork& other) {
+    parameters = other.parameters;
+    mapped_parameters = other.mapped_parameters;
+    layers = other.layers;
+    optimiser = other.optimiser;
+    bind_layers();
+    return *this;
+}
 
 /*
     Class: NeuralNetwork
@@ -29,7 +97,8 @@ NeuralNetwork::NeuralNetwork(float learning_rate) : learning_rate(learning_rate)
     Arguments:
         (int) input_size: The input size of the layer.
         (int) output_size: The output size of the layer.
-        (double) learning_rate: The learning rate of the neural network.
+        (Rng) rng: The generator for the layer's initial weights, by default the calling
+            thread's, pass a seeded one for a reproducible network.
     
     Returns:
         None
@@ -38,15 +107,145 @@ NeuralNetwork::NeuralNetwork(float learning_rate) : learning_rate(learning_rate)
 
         Code:
 
-        layers.emplace_back(input_size, output_size);
+        parameters.resize(offset + Layer::parameter_count(input_size, output_size));
+        bind_layers();
+
+        Explanation:
+
+        Grow the parameter buffer by the new layer's block, zeroed. Growing can move the buffer,
+        so the existing layers are pointed at it again.
+
+        Code:
+
+        layers.emplace_back(input_size, output_size, parameters.data() + offset, rng);
 
         Explanation:
 
         Create a layer object and place into layers vector without needing to perform copy
-        or move operation.
+        or move operation. The layer initialises its block of the parameter buffer.
+*/ 
+void NeuralNetwork::add_layer(int input_size, int output_size, Rng& rng) {
+    require_owned_parameters("add a layer to");
+    size_t offset = parameters.size();
+    parameters.resize(offset + Layer::parameter_count(input_size, output_size));
+    bind_layers();
+    layers.emplace_back(input_size, output_size, parameters.data() + offset, rng);
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: bind_layers
+
+    Description: Point every layer at its block of the parameter buffer, or of the mapped
+        parameters.
+
+    Arguments:
+        None
+    
+    Returns:
+        None
+*/ 
+void NeuralNetwork::bind_layers() {
+    float* data = parameter_data();
+    size_t offset = 0;
+    for (auto& layer : layers) {
+        layer.bind(data + offset);
+        offset += Layer::parameter_count(layer.input_size, layer.output_size);
+    }
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: require_owned_parameters
+
+    Description: Throw if the network views mapped parameters, for the operations which would
+        write to them.
+
+    Arguments:
+        (const char*) operation: What was attempted, for the error message.
+    
+    Returns:
+        None
+*/ 
+void NeuralNetwork::require_owned_parameters(const char* operation) const {
+    if (mapped_parameters != nullptr) {
+        throw std::runtime_error(std::string("Cannot ") + operation + " a network mapped from a checkpoint");
+    }
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: parameter_data
+
+    Description: The start of the parameters the layers view, the parameter buffer or the mapped
+        parameters.
+
+    Arguments:
+        None
+    
+    Returns:
+        (float*) Pointer to parameter_count floats.
+*/ 
+float* NeuralNetwork::parameter_data() {
+    return mapped_parameters != nullptr ? mapped_parameters : parameters.data();
+}
+
+const float* NeuralNetwork::parameter_data() const {
+    return mapped_parameters != nullptr ? mapped_parameters : parameters.data();
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: parameter_count
+
+    Description: The number of floats of parameters of all layers, padding included.
+
+    Arguments:
+        None
+    
+    Returns:
+        (size_t) The number of floats.
+*/ 
+size_t NeuralNetwork::parameter_count() const {
+    size_t count = 0;
+    for (const auto& layer : layers) {
+        count += Layer::parameter_count(layer.input_size, layer.output_size);
+    } return count;
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: map_parameters
+
+    Description: Make the layers view parameters held outside the network, laid out as the
+        parameter buffer would be, and release the parameter buffer. Used to evaluate a memory
+        mapped checkpoint in place. The data must outlive the network and every copy of it.
+
+    Arguments:
+        (float*) data: parameter_count floats, aligned to MATRIX_ALIGNMENT.
+    
+    Returns:
+        None
 */ 
-void NeuralNetwork::add_layer(int input_size, int output_size) {
-    layers.emplace_back(input_size, output_size, learning_rate);
+void NeuralNetwork::map_parameters(float* data) {
+    mapped_parameters = data;
+    AlignedVector().swap(parameters);
+    bind_layers();
 }
 
 /*
@@ -82,6 +281,216 @@ std::vector<float> NeuralNetwork::forward(const std::vector<float>& input) {
     } return output;
 }
 
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: infer
+
+    Description: Perform forward propagation on one input for inference, for example to select
+        an action. See infer_batch.
+
+    Arguments:
+        (const float*) input: The inputs to the network, one per input of the first layer.
+        (Workspace) workspace: Scratch memory for the activations.
+    
+    Returns:
+        (const float*) The outputs of the network, which point into the workspace and are valid
+            until its next use.
+*/ 
+const float* NeuralNetwork::infer(const float* input, Workspace& workspace) const {
+    return infer_batch(input, 1, workspace);
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: infer_batch
+
+    Description: Perform forward propagation on a batch of inputs for inference. Unlike forward
+        and forward_batch nothing is kept for back propagation and the network is only read,
+        the activations of each layer are written alternately into the two workspace buffers.
+        Hence nothing is allocated, and any number of threads can evaluate the same network at
+        once as long as each uses its own workspace. The outputs are exactly those of forward
+        for a single input and forward_batch for a batch.
+
+    Arguments:
+        (const float*) input: A batch_size x input_size row-major matrix, one input per row.
+        (int) batch_size: The number of inputs, at most the workspace's max_batch_size.
+        (Workspace) workspace: Scratch memory for the activations.
+    
+    Returns:
+        (const float*) A batch_size x output_size row-major matrix of outputs, which points into
+            the workspace and is valid until its next use.
+*/ 
+const float* NeuralNetwork::infer_batch(const float* input, int batch_size, Workspace& workspace) const {
+    if (batch_size > workspace.max_batch_size) {
+        throw std::runtime_error("infer_batch: batch size " + std::to_string(batch_size) + " is larger than the workspace's "
+                                 + std::to_string(workspace.max_batch_size));
+    }
+
+    const float* activations = input;
+    float* output = workspace.buffer_a.data();
+    for (const auto& layer : layers) {
+        layer.infer(activations, batch_size, output);
+        activations = output;
+        output = output == workspace.buffer_a.data() ? workspace.buffer_b.data() : workspace.buffer_a.data();
+    } return activations;
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Constructor
+
+    Name: Workspace
+
+    Description: Allocate the scratch memory for inference with a network.
+
+    Arguments:
+        (NeuralNetwork) network: The network the workspace will be used with. Any network with
+            the same layer sizes can use it too, for example the target network.
+        (int) max_batch_size: The largest batch the workspace will be used for.
+    
+    Returns:
+        None
+*/ 
+NeuralNetwork::Workspace::Workspace(const NeuralNetwork& network, int max_batch_size)
+    : buffer_a(max_batch_size * network.max_output_size())
+    , buffer_b(max_batch_size * network.max_output_size())
+    , max_batch_size(max_batch_size)
+{}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: max_output_size
+
+    Description: The largest number of outputs of any layer, which is the size of the workspace
+        buffers needed per input by infer.
+
+    Arguments:
+        None
+    
+    Returns:
+        (int) The largest output_size of the layers.
+*/ 
+int NeuralNetwork::max_output_size() const {
+    int size = 0;
+    for (const auto& layer : layers) {
+        size = std::max(size, layer.output_size);
+    } return size;
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: same_shape
+
+    Description: Check whether another network has the same layer sizes, in which case its
+        parameter buffer has the same layout as this one.
+
+    Arguments:
+        (NeuralNetwork) other: The network to compare with.
+    
+    Returns:
+        (bool) True if every layer has the same input and output size.
+*/ 
+bool NeuralNetwork::same_shape(const NeuralNetwork& other) const {
+    if (other.layers.size() != layers.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < layers.size(); i++) {
+        if (other.layers[i].input_size != layers[i].input_size || other.layers[i].output_size != layers[i].output_size) {
+            return false;
+        }
+    } return true;
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: copy_parameters
+
+    Description: Copy the weights and biases of another network with the same layer sizes. Only
+        the parameters are copied, the training buffers, gradients, optimiser moments and
+        optimiser settings of this network are left as they are.
+
+    Arguments:
+        (NeuralNetwork) source: The network to copy the parameters from.
+    
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    std::copy(source_data, source_data + parameters.size(), parameters.begin());
+
+    Explanation:
+
+    Both networks keep all their parameters in one buffer with the same layout, so this is a
+    single memcpy with no memory allocation.
+*/ 
+void NeuralNetwork::copy_parameters(const NeuralNetwork& source) {
+    require_owned_parameters("copy parameters into");
+    if (!same_shape(source)) {
+        throw std::runtime_error("Mismatch in layer sizes when copying network parameters");
+    }
+
+    const float* source_data = source.parameter_data();
+    std::copy(source_data, source_data + parameters.size(), parameters.begin());
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: soft_update
+
+    Description: Move the parameters a fraction tau of the way towards the parameters of another
+        network with the same layer sizes, the Polyak averaged target network update:
+        parameters = (1 - tau) * parameters + tau * source.parameters.
+
+    Arguments:
+        (NeuralNetwork) source: The network to move towards.
+        (float) tau: The fraction, between 0 and 1. A tau of 1 copies the parameters.
+    
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    simdKernels().lerp(tau, source.parameter_data(), parameters.data(), parameters.size());
+
+    Explanation:
+
+    One vectorised pass over the whole buffer. The padding of both networks is zero, so it stays
+    zero.
+*/ 
+void NeuralNetwork::soft_update(const NeuralNetwork& source, float tau) {
+    require_owned_parameters("update the parameters of");
+    if (!same_shape(source)) {
+        throw std::runtime_error("Mismatch in layer sizes when updating network parameters");
+    }
+
+    simdKernels().lerp(tau, source.parameter_data(), parameters.data(), parameters.size());
+}
+
 /*
     Class: NeuralNetwork
 
@@ -108,21 +517,90 @@ std::vector<float> NeuralNetwork::forward(const std::vector<float>& input) {
         Explanation:
 
         Iterate through layers in reverse. Apply back propagation to each layer.
+
+        Code:
+
+        optimiser.begin_step();
+        for (auto& layer : layers)
+            layer.apply_gradients(optimiser);
+
+        Explanation:
+
+        Once every layer has its gradients, update the parameters with the optimiser.
         
 */ 
 void NeuralNetwork::backward(const std::vector<float>& grad) {
+    require_owned_parameters("train");
     std::vector<float> delta = grad;
     for (auto layer = layers.rbegin(); layer != layers.rend(); ++layer)
         delta = layer->backward(delta);
+
+    optimiser.begin_step();
+    for (auto& layer : layers)
+        layer.apply_gradients(optimiser);
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: forward_batch
+
+    Description: Perform forward propagation on a minibatch of inputs.
+
+    Arguments:
+        (std::vector<float>) input: A batch_size x input_size row-major matrix, one input per row.
+        (int) batch_size: The number of inputs in the batch.
+    
+    Returns:
+        (const std::vector<float>&) A batch_size x output_size row-major matrix, one output per
+            row. The reference is to the batch outputs of the last layer and is valid until the
+            next call.
+*/ 
+const std::vector<float>& NeuralNetwork::forward_batch(const std::vector<float>& input, int batch_size) {
+    const std::vector<float>* output = &input;
+    for (auto& layer : layers) {
+        output = &layer.forward_batch(*output, batch_size);
+    } return *output;
+}
+
+/*
+    Class: NeuralNetwork
+
+    Component: Method
+
+    Name: backward_batch
+
+    Description: Perform back propagation for the last minibatch passed to forward_batch, applying
+        one optimiser update to every layer.
+
+    Arguments:
+        (std::vector<float>) grad: A batch_size x output_size row-major matrix of the derivative of
+            the loss value with respect to the predicted values.
+        (int) batch_size: The number of samples in the batch.
+    
+    Returns:
+        None
+*/ 
+void NeuralNetwork::backward_batch(const std::vector<float>& grad, int batch_size) {
+    require_owned_parameters("train");
+    const std::vector<float>* delta = &grad;
+    for (auto layer = layers.rbegin(); layer != layers.rend(); ++layer)
+        delta = &layer->backward_batch(*delta, batch_size);
+
+    optimiser.begin_step();
+    for (auto& layer : layers)
+        layer.apply_gradients(optimiser);
 }
 
 void NeuralNetwork::load_in_network_params(std::vector<std::vector<std::vector<float>>>& loaded_weights, std::vector<std::vector<float>>& loaded_biases) {
+    require_owned_parameters("load parameters into");
 
 
     if (loaded_weights.size() != layers.size() || loaded_biases.size() != layers.size()) {
-        std::cout << loaded_weights.size() << std::endl;
-        std::cout << loaded_biases.size() << std::endl;
-        std::cout << layers.size() << std::endl;
+        LOG_ERROR("loaded weight layers: " << loaded_weights.size() << " ::: loaded bias layers: " << loaded_biases.size()
+                  << " ::: network layers: " << layers.size());
         throw std::runtime_error("Mismatch in number of layers and loaded parameters");
     }
 
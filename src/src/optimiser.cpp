@@ -0,0 +1,162 @@
+#include <cmath>
+
+#include "../include/optimiser.h"
+#include "../include/simd_kernels.h"
+
+/*
+    Class: Optimiser
+
+    Component: Constructor
+
+    Name: Optimiser
+
+    Description: Create a plain stochastic gradient descent optimiser, which has no moments.
+
+    Arguments:
+        (float) learning_rate: The step size of each update.
+
+    Returns:
+        None
+*/
+Optimiser::Optimiser(float learning_rate)
+    : Optimiser(OPTIMISER_SGD, learning_rate, 0.9f, 0.9f, 0.999f, 0.99f, 1e-8f)
+{}
+
+/*
+    Class: Optimiser
+
+    Component: Constructor
+
+    Name: Optimiser
+
+    Description: Create an optimiser. Only the hyperparameters of the chosen type are used.
+
+    Arguments:
+        (OptimiserType) type: SGD, momentum, RMSprop or Adam.
+        (float) learning_rate: The step size of each update.
+        (float) momentum: Momentum, the decay of the velocity.
+        (float) beta1: Adam, the decay of the first moment.
+        (float) beta2: Adam, the decay of the second moment.
+        (float) decay: RMSprop, the decay of the mean squared gradient.
+        (float) epsilon: Adam and RMSprop, added to the root mean square before dividing.
+
+    Returns:
+        None
+*/
+Optimiser::Optimiser(OptimiserType type, float learning_rate, float momentum, float beta1, float beta2, float decay, float epsilon)
+    : type(type)
+    , learning_rate(learning_rate)
+    , momentum(momentum)
+    , beta1(beta1)
+    , beta2(beta2)
+    , decay(decay)
+    , epsilon(epsilon)
+    , t(0)
+    , step_size(learning_rate)
+    , step_epsilon(epsilon)
+{}
+
+/*
+    Class: Optimiser
+
+    Component: Method
+
+    Name: moment_count
+
+    Description: The number of moment values the optimiser keeps per parameter. Layers size their
+        moment buffers as moment_count() times the number of parameters.
+
+    Arguments:
+        None
+
+    Returns:
+        (int) 0 for SGD, 1 for momentum (the velocity) and RMSprop (the mean squared gradient),
+            2 for Adam (the first and second moments).
+*/
+int Optimiser::moment_count() const {
+    switch (type) {
+        case OPTIMISER_MOMENTUM: return 1;
+        case OPTIMISER_RMSPROP: return 1;
+        case OPTIMISER_ADAM: return 2;
+        default: return 0;
+    }
+}
+
+/*
+    Class: Optimiser
+
+    Component: Method
+
+    Name: begin_step
+
+    Description: Advance the step count, once per training step before the layers are updated.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    float correction1 = 1.0f - std::pow(beta1, t);
+    float correction2 = 1.0f - std::pow(beta2, t);
+    step_size = learning_rate * std::sqrt(correction2) / correction1;
+    step_epsilon = epsilon * std::sqrt(correction2);
+
+    Explanation:
+
+    Adam divides the moments by (1 - beta^t) to remove their bias towards zero over the first
+    steps. Folding the correction into the step size and epsilon once per step gives the same
+    update, lr * m_hat / (sqrt(v_hat) + epsilon), without dividing every moment by it.
+*/
+void Optimiser::begin_step() {
+    t++;
+    if (type == OPTIMISER_ADAM) {
+        float correction1 = 1.0f - std::pow(beta1, t);
+        float correction2 = 1.0f - std::pow(beta2, t);
+        step_size = learning_rate * std::sqrt(correction2) / correction1;
+        step_epsilon = epsilon * std::sqrt(correction2);
+    }
+}
+
+/*
+    Class: Optimiser
+
+    Component: Method
+
+    Name: update
+
+    Description: Apply the gradients of one parameter array. Each update is a single fused
+        vector kernel which reads the gradients and moments and writes the moments and
+        parameters in one pass, see simd_kernels.h.
+
+    Arguments:
+        (float*) parameters: The n parameters to update.
+        (const float*) gradients: The n gradients of the loss with respect to the parameters.
+        (float*) moments: The moment_count() x n moments of the parameters, zero before the
+            first step. For Adam the first moments come first, then the second moments.
+        (int) n: The number of parameters.
+
+    Returns:
+        None
+*/
+void Optimiser::update(float* parameters, const float* gradients, float* moments, int n) const {
+    const SimdKernels& kernels = simdKernels();
+    switch (type) {
+        case OPTIMISER_MOMENTUM:
+            kernels.momentum_update(learning_rate, momentum, gradients, moments, parameters, n);
+            break;
+        case OPTIMISER_RMSPROP:
+            kernels.rmsprop_update(learning_rate, decay, epsilon, gradients, moments, parameters, n);
+            break;
+        case OPTIMISER_ADAM:
+            kernels.adam_update(step_size, beta1, beta2, step_epsilon, gradients, moments, moments + n, parameters, n);
+            break;
+        default:
+            kernels.axpy(-learning_rate, gradients, parameters, n);
+            break;
+    }
+}
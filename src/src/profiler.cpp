@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#include "../include/profiler.h"
+
+const char* const PROFILE_PHASE_NAMES[PHASE_COUNT] = {
+    "select_action",
+    "environment_step",
+    "snake_update",
+    "reward",
+    "collisions",
+    "encode_state",
+    "store_experience",
+    "target_update",
+    "train",
+    "train/sample",
+    "train/forward",
+    "train/target_forward",
+    "train/backward",
+    "train/priorities",
+    "queue_drain",
+    "publish_weights",
+    "logging",
+    "draw"
+};
+
+const char* const PROFILE_COUNTER_NAMES[COUNTER_COUNT] = {
+    "env_steps",
+    "gradient_steps",
+    "games"
+};
+
+/*
+    Function: profiler
+
+    Description: The process wide profiler which the PROFILE_ macros record into.
+
+    Arguments:
+        None
+
+    Returns:
+        (Profiler&) The profiler.
+*/
+Profiler& profiler() {
+    static Profiler instance;
+    return instance;
+}
+
+/*
+    Class: Profiler
+
+    Component: Constructor
+
+    Name: Profiler
+
+    Description: Start the run's clock.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+Profiler::Profiler() {
+    reset();
+}
+
+/*
+    Class: Profiler
+
+    Component: Method
+
+    Name: reset
+
+    Description: Clear every thread's statistics and restart the run's clock, for example once
+        setup is done so that it is not counted. Must not be called while other threads record.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& stats : thread_stats) {
+        std::memset(stats.get(), 0, sizeof(ProfileStats));
+    }
+    start_time = std::chrono::steady_clock::now();
+    start_ticks = profileTicks();
+}
+
+/*
+    Class: Profiler
+
+    Component: Method
+
+    Name: threadStats
+
+    Description: The calling thread's statistics, created the first time the thread records.
+
+    Arguments:
+        None
+
+    Returns:
+        (ProfileStats&) The calling thread's statistics.
+
+    Code Explanation:
+
+    Code:
+
+    thread_local ProfileStats* stats = nullptr;
+
+    Explanation:
+
+    After the first call a thread reaches its statistics through one thread local pointer, without
+    the lock. The statistics themselves belong to the profiler, so they are still there for the
+    report after the thread has finished.
+*/
+ProfileStats& Profiler::threadStats() {
+    thread_local ProfileStats* stats = nullptr;
+    if (stats == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_stats.emplace_back(new ProfileStats());
+        stats = thread_stats.back().get();
+    } return *stats;
+}
+
+/*
+    Class: Profiler
+
+    Component: Method
+
+    Name: merged
+
+    Description: The statistics of every thread added together. Threads which record must have
+        finished, or be paused, for the totals to be consistent.
+
+    Arguments:
+        None
+
+    Returns:
+        (ProfileStats) The combined statistics.
+*/
+ProfileStats Profiler::merged() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ProfileStats total = {};
+    for (auto& stats : thread_stats) {
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            PhaseStats& into = total.phases[p];
+            const PhaseStats& from = stats->phases[p];
+            into.calls += from.calls;
+            into.total_ticks += from.total_ticks;
+            into.max_ticks = std::max(into.max_ticks, from.max_ticks);
+            for (int b = 0; b < ProfileHistogram::BUCKETS; b++) {
+                into.histogram.counts[b] += from.histogram.counts[b];
+            }
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            total.counters[c] += stats->counters[c];
+        }
+    } return total;
+}
+
+/*
+    Class: Profiler
+
+    Component: Method
+
+    Name: elapsed
+
+    Description: The wall time since reset and the tick rate measured over it.
+
+    Arguments:
+        (double) wall_seconds: Set to the seconds since reset.
+        (double) ticks_per_second: Set to the ticks of profileTicks per second.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    ticks_per_second = wall_seconds > 0 ? (profileTicks() - start_ticks) / wall_seconds : 1e9;
+
+    Explanation:
+
+    The time stamp counter runs at a fixed rate that depends on the processor, so it is measured
+    against steady_clock over the whole run rather than assumed. The longer the run the better the
+    estimate, and only the report pays for it.
+*/
+void Profiler::elapsed(double& wall_seconds, double& ticks_per_second) const {
+    wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    ticks_per_second = wall_seconds > 0 ? (profileTicks() - start_ticks) / wall_seconds : 1e9;
+}
+
+// The duration below which the given fraction of calls fall, estimated as the middle of the
+// histogram bucket it lands in.
+static double percentileTicks(const PhaseStats& stats, double fraction) {
+    uint64_t target = (uint64_t)(fraction * (stats.calls - 1)) + 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < ProfileHistogram::BUCKETS; b++) {
+        seen += stats.histogram.counts[b];
+        if (seen >= target) {
+            double lower = ProfileHistogram::lowerBound(b);
+            double upper = b + 1 < ProfileHistogram::BUCKETS ? ProfileHistogram::lowerBound(b + 1) : lower;
+            return std::min((lower + upper) / 2, (double)stats.max_ticks);
+        }
+    } return stats.max_ticks;
+}
+
+/*
+    Class: Profiler
+
+    Component: Method
+
+    Name: printSummary
+
+    Description: Print a table of every phase which ran, with its share of the wall time and its
+        latency distribution, followed by the counters and their rates.
+
+    Arguments:
+        (std::ostream) out: The stream to print to.
+
+    Returns:
+        None
+*/
+void Profiler::printSummary(std::ostream& out) {
+    ProfileStats total = merged();
+    double wall_seconds, ticks_per_second;
+    elapsed(wall_seconds, ticks_per_second);
+    double us_per_tick = 1e6 / ticks_per_second;
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << std::left << std::setw(22) << "phase" << std::right
+        << std::setw(10) << "calls" << std::setw(12) << "total ms" << std::setw(9) << "% wall"
+        << std::setw(11) << "mean us" << std::setw(11) << "p50 us" << std::setw(11) << "p90 us"
+        << std::setw(11) << "p99 us" << std::setw(11) << "max us" << std::endl;
+
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats& stats = total.phases[p];
+        if (stats.calls == 0) continue;
+        double total_ms = stats.total_ticks * us_per_tick / 1000;
+        out << std::left << std::setw(22) << PROFILE_PHASE_NAMES[p] << std::right
+            << std::setw(10) << stats.calls
+            << std::setw(12) << total_ms
+            << std::setw(9) << (wall_seconds > 0 ? total_ms / 10 / wall_seconds : 0)
+            << std::setw(11) << stats.total_ticks * us_per_tick / stats.calls
+            << std::setw(11) << percentileTicks(stats, 0.5) * us_per_tick
+            << std::setw(11) << percentileTicks(stats, 0.9) * us_per_tick
+            << std::setw(11) << percentileTicks(stats, 0.99) * us_per_tick
+            << std::setw(11) << stats.max_ticks * us_per_tick << std::endl;
+    }
+
+    out << "wall: " << wall_seconds << " s";
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out << " ::: " << PROFILE_COUNTER_NAMES[c] << ": " << total.counters[c]
+            << " (" << (wall_seconds > 0 ? total.counters[c] / wall_seconds : 0) << "/sec)";
+    } out << std::endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+/*
+    Class: Profiler
+
+    Component: Method
+
+    Name: writeReport
+
+    Description: Write the same statistics as printSummary as JSON, for comparing runs with a
+        script. Each phase includes its non empty histogram buckets as [lower bound us, count].
+
+    Arguments:
+        (std::string) filepath: The file to write, replaced if it exists.
+
+    Returns:
+        None
+*/
+void Profiler::writeReport(const std::string& filepath) {
+    ProfileStats total = merged();
+    double wall_seconds, ticks_per_second;
+    elapsed(wall_seconds, ticks_per_second);
+    double us_per_tick = 1e6 / ticks_per_second;
+
+    std::ofstream file(filepath);
+    if (!file) {
+        throw std::runtime_error("Could not open profile report for writing: " + filepath);
+    }
+    file << std::setprecision(9);
+    file << "{\n  \"wall_seconds\": " << wall_seconds << ",\n  \"ticks_per_second\": " << ticks_per_second << ",\n";
+
+    file << "  \"phases\": [";
+    bool first_phase = true;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats& stats = total.phases[p];
+        if (stats.calls == 0) continue;
+        file << (first_phase ? "\n" : ",\n");
+        first_phase = false;
+        file << "    {\"name\": \"" << PROFILE_PHASE_NAMES[p] << "\", \"calls\": " << stats.calls
+             << ", \"total_seconds\": " << stats.total_ticks * us_per_tick / 1e6
+             << ", \"mean_us\": " << stats.total_ticks * us_per_tick / stats.calls
+             << ", \"p50_us\": " << percentileTicks(stats, 0.5) * us_per_tick
+             << ", \"p90_us\": " << percentileTicks(stats, 0.9) * us_per_tick
+             << ", \"p99_us\": " << percentileTicks(stats, 0.99) * us_per_tick
+             << ", \"max_us\": " << stats.max_ticks * us_per_tick
+             << ", \"histogram\": [";
+        bool first_bucket = true;
+        for (int b = 0; b < ProfileHistogram::BUCKETS; b++) {
+            if (stats.histogram.counts[b] == 0) continue;
+            file << (first_bucket ? "" : ", ") << "[" << ProfileHistogram::lowerBound(b) * us_per_tick << ", " << stats.histogram.counts[b] << "]";
+            first_bucket = false;
+        } file << "]}";
+    } file << "\n  ],\n";
+
+    file << "  \"counters\": {";
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        file << (c == 0 ? "\n" : ",\n") << "    \"" << PROFILE_COUNTER_NAMES[c] << "\": {\"total\": " << total.counters[c]
+             << ", \"per_second\": " << (wall_seconds > 0 ? total.counters[c] / wall_seconds : 0) << "}";
+    } file << "\n  }\n}\n";
+}
@@ -0,0 +1,225 @@
+#include <cmath>
+
+#include "../include/reward.h"
+
+/*
+    Class: DistanceShaping
+
+    Component: Constructor
+
+    Name: DistanceShaping
+
+    Description: Set up the distance shaping with the reward per cell moved towards the food.
+
+    Arguments:
+        (float) move_towards_food_reward: The reward for each cell of distance gained, the
+            same amount is taken off for each cell of distance lost.
+
+    Returns:
+        None
+*/
+DistanceShaping::DistanceShaping(float move_towards_food_reward)
+    : move_towards_food_reward(move_towards_food_reward)
+{}
+
+/*
+    Class: DistanceShaping
+
+    Component: Method
+
+    Name: reward
+
+    Description: Reward the change in straight line distance between the snake head and the
+        food over the last step.
+
+    Arguments:
+        (Snake) snake: The snake object, after it has moved.
+        (Food) food: The food object.
+        (Cell) previous_head_position: The snake head before it moved.
+
+    Returns:
+        (float) The distance change multiplied by move_towards_food_reward, positive when the
+            snake moved towards the food.
+
+    Code Explanation:
+
+    Code:
+
+    float previous_distance = std::sqrt(previous_dx * previous_dx + previous_dy * previous_dy);
+
+    Explanation:
+
+    The coordinates are small integers, so the squares are exact in float and the single
+    precision square root gives the same result the double precision pow and sqrt did.
+*/
+float DistanceShaping::reward(const Snake &snake, const Food &food, Cell previous_head_position) const {
+    Cell head = snake.head();
+    float previous_dx = previous_head_position.x - food.position.x;
+    float previous_dy = previous_head_position.y - food.position.y;
+    float current_dx = head.x - food.position.x;
+    float current_dy = head.y - food.position.y;
+
+    float previous_distance = std::sqrt(previous_dx * previous_dx + previous_dy * previous_dy);
+    float current_distance = std::sqrt(current_dx * current_dx + current_dy * current_dy);
+
+    return (previous_distance - current_distance) * move_towards_food_reward;
+}
+
+/*
+    Class: TimePenaltyShaping
+
+    Component: Constructor
+
+    Name: TimePenaltyShaping
+
+    Description: Set up the time penalty shaping.
+
+    Arguments:
+        (float) general_time_penalty: The reward of every step, usually a small negative value.
+
+    Returns:
+        None
+*/
+TimePenaltyShaping::TimePenaltyShaping(float general_time_penalty)
+    : general_time_penalty(general_time_penalty)
+{}
+
+/*
+    Class: TimePenaltyShaping
+
+    Component: Method
+
+    Name: reward
+
+    Description: Give the same reward every step, regardless of where the snake moved.
+
+    Arguments:
+        (Snake) snake: The snake object, unused.
+        (Food) food: The food object, unused.
+        (Cell) previous_head_position: The snake head before it moved, unused.
+
+    Returns:
+        (float) general_time_penalty.
+*/
+float TimePenaltyShaping::reward(const Snake &/*snake*/, const Food &/*food*/, Cell /*previous_head_position*/) const {
+    return general_time_penalty;
+}
+
+/*
+    Class: RewardEngine
+
+    Component: Constructor
+
+    Name: RewardEngine
+
+    Description: Copy the reward values out of the parameters once, so that computing a reward
+        does not construct any parameter structs. Distance shaping is used for steps which do
+        not end in food or a collision, see setShaping to change it.
+
+    Arguments:
+        (NetworkParams) network_params: The training parameters. Holds the reward values, see
+            network_params.h.
+        (GameParams) game_params: The game parameters. Holds the size of the board.
+
+    Returns:
+        None
+*/
+RewardEngine::RewardEngine(const NetworkParams &network_params, const GameParams &game_params)
+    : food_reward(network_params.food_reward)
+    , self_collision_penalty(network_params.self_collision_penalty)
+    , edge_collision_penalty(network_params.edge_collision_penalty)
+    , cell_count(game_params.cell_count)
+    , shaping(new DistanceShaping(network_params.move_towards_food_reward))
+{}
+
+/*
+    Class: RewardEngine
+
+    Component: Method
+
+    Name: setShaping
+
+    Description: Replace the reward of steps which end neither in food nor in a collision.
+
+    Arguments:
+        (std::unique_ptr<RewardShaping>) shaping: The new shaping, the engine takes ownership.
+
+    Returns:
+        None
+*/
+void RewardEngine::setShaping(std::unique_ptr<RewardShaping> shaping) {
+    this->shaping = std::move(shaping);
+}
+
+/*
+    Class: RewardEngine
+
+    Component: Method
+
+    Name: reward
+
+    Description: Get the reward of the last step. Must be called after the snake has moved and
+        before the collisions are checked, since checking collisions moves the food and resets
+        the snake.
+
+    Arguments:
+        (Snake) snake: The snake object.
+        (Food) food: The food object.
+        (Cell) previous_head_position: The snake head before it moved.
+
+    Returns:
+        (float) A reward. See the network_params.h header file for the values.
+            Positive rewards will encourage snake to win, whilst negative rewards,
+            will discourage snake from behaviours that will cause it to lose.
+
+    Code explanation:
+
+    Code:
+
+    if (head == food.position) return food_reward;
+
+    Explanation:
+
+    If snake head is same position as food, hence eats a food, return the
+    food reward.
+
+    Code:
+
+    if (snake.head_collision) return self_collision_penalty;
+
+    Explanation:
+
+    If snake head is same position as part of its body, hence it has collided, 
+    with itself return self collision penalty. The snake works this out from its
+    occupancy bitboard when it moves.
+
+    Code:
+
+    if (head.x < 0 || head.x >= cell_count || head.y < 0 || head.y >= cell_count) return edge_collision_penalty;
+
+    Explanation:
+
+    If snake head is past one of the borders of the game, vertical or horizontal, 
+    return edge collision penalty.
+
+    Code:
+
+    return shaping->reward(snake, food, previous_head_position);
+
+    Explanation:
+
+    Otherwise the step is rewarded by the shaping function.
+*/
+float RewardEngine::reward(const Snake &snake, const Food &food, Cell previous_head_position) const {
+    Cell head = snake.head();
+    if (head == food.position) {
+        return food_reward;
+    }
+    if (snake.head_collision) {
+        return self_collision_penalty;
+    }
+    if (head.x < 0 || head.x >= cell_count || head.y < 0 || head.y >= cell_count) {
+        return edge_collision_penalty;
+    }
+    return shaping->reward(snake, food, previous_head_position);
+}
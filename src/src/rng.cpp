@@ -0,0 +1,90 @@
+#include <atomic>
+#include <random>
+
+#include "../include/rng.h"
+
+// SplitMix64 finaliser, spreads neighbouring seeds such as random_seed + i over the whole state.
+static uint64_t mixSeed(uint64_t seed) {
+    seed += 0x9e3779b97f4a7c15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+    return seed ^ (seed >> 31);
+}
+
+/*
+    Class: Rng
+
+    Component: Constructor
+
+    Name: Rng
+
+    Description: Seed a generator on one of its streams. The same seed and stream always give the
+        same sequence.
+
+    Arguments:
+        (uint64_t) seed: The seed, see rngSeed.
+        (uint64_t) stream: The stream, see RngStream.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    increment = (stream << 1) | 1;
+
+    Explanation:
+
+    The stream picks the odd increment of the underlying linear congruential generator, each
+    increment gives a different sequence through all 2^64 states. This is PCG's own seeding
+    procedure, with the seed mixed first so that close seeds do not start close together.
+*/
+Rng::Rng(uint64_t seed, uint64_t stream)
+    : state(0)
+    , increment((stream << 1) | 1)
+{
+    next();
+    state += mixSeed(seed);
+    next();
+}
+
+/*
+    Function: rngSeed
+
+    Description: Turn a seed parameter into a generator seed. A negative parameter means no fixed
+        seed, a fresh one is taken from std::random_device.
+
+    Arguments:
+        (int) seed: The seed parameter, e.g. NetworkParams::RANDOM_SEED.
+
+    Returns:
+        (uint64_t) The seed.
+*/
+uint64_t rngSeed(int seed) {
+    if (seed >= 0) {
+        return (uint64_t)seed;
+    }
+    std::random_device device;
+    return (uint64_t)device() << 32 | device();
+}
+
+/*
+    Function: threadRng
+
+    Description: A generator for the calling thread, for randomness which has no seed of its own
+        to follow, such as the initial weights of a network built outside the DQN. Each thread
+        gets its own stream of one process wide random seed.
+
+    Arguments:
+        None
+
+    Returns:
+        (Rng&) The calling thread's generator.
+*/
+Rng& threadRng() {
+    static const uint64_t process_seed = rngSeed(-1);
+    static std::atomic<uint64_t> threads(0);
+    thread_local Rng rng(process_seed, RNG_STREAM_THREADS + threads.fetch_add(1));
+    return rng;
+}
@@ -0,0 +1,561 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "../include/simd_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+/*
+    Scalar kernels. These are the plain loops the layers used before the vector kernels, and
+    are used on CPUs (or compilers) without a supported instruction set.
+*/
+static float dotScalar(const float* a, const float* b, int n) {
+    float sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static void dot4Scalar(const float* x, const float* a0, const float* a1, const float* a2, const float* a3, int n, float* out) {
+    float sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+    for (int i = 0; i < n; i++) {
+        sum0 += a0[i] * x[i];
+        sum1 += a1[i] * x[i];
+        sum2 += a2[i] * x[i];
+        sum3 += a3[i] * x[i];
+    }
+    out[0] = sum0;
+    out[1] = sum1;
+    out[2] = sum2;
+    out[3] = sum3;
+}
+
+static void axpyScalar(float alpha, const float* x, float* y, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+static void biasReluScalar(const float* bias, float* y, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = std::max(0.0f, y[i] + bias[i]);
+    }
+}
+
+static void momentumUpdateScalar(float learning_rate, float momentum, const float* g, float* m, float* w, int n) {
+    for (int i = 0; i < n; i++) {
+        m[i] = momentum * m[i] + g[i];
+        w[i] -= learning_rate * m[i];
+    }
+}
+
+static void rmspropUpdateScalar(float learning_rate, float decay, float epsilon, const float* g, float* v, float* w, int n) {
+    for (int i = 0; i < n; i++) {
+        v[i] = decay * v[i] + (1.0f - decay) * g[i] * g[i];
+        w[i] -= learning_rate * g[i] / (std::sqrt(v[i]) + epsilon);
+    }
+}
+
+static void adamUpdateScalar(float step_size, float beta1, float beta2, float epsilon, const float* g, float* m, float* v, float* w, int n) {
+    for (int i = 0; i < n; i++) {
+        m[i] = beta1 * m[i] + (1.0f - beta1) * g[i];
+        v[i] = beta2 * v[i] + (1.0f - beta2) * g[i] * g[i];
+        w[i] -= step_size * m[i] / (std::sqrt(v[i]) + epsilon);
+    }
+}
+
+static void lerpScalar(float t, const float* x, float* y, int n) {
+    for (int i = 0; i < n; i++) {
+        y[i] = (1.0f - t) * y[i] + t * x[i];
+    }
+}
+
+#ifdef SIMD_X86
+
+/*
+    SSE kernels, four floats per register. SSE has no fused multiply add, hence a separate
+    multiply and add.
+*/
+TARGET_SSE static inline float horizontalSum128(__m128 v) {
+    __m128 shuffled = _mm_movehl_ps(v, v);
+    __m128 sums = _mm_add_ps(v, shuffled);
+    shuffled = _mm_shuffle_ps(sums, sums, 0x55);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+TARGET_SSE static float dotSse(const float* a, const float* b, int n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    float sum = horizontalSum128(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+TARGET_SSE static void dot4Sse(const float* x, const float* a0, const float* a1, const float* a2, const float* a3, int n, float* out) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps(), acc3 = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 xv = _mm_loadu_ps(x + i);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a0 + i), xv));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a1 + i), xv));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(a2 + i), xv));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(a3 + i), xv));
+    }
+    float sum0 = horizontalSum128(acc0), sum1 = horizontalSum128(acc1);
+    float sum2 = horizontalSum128(acc2), sum3 = horizontalSum128(acc3);
+    for (; i < n; i++) {
+        sum0 += a0[i] * x[i];
+        sum1 += a1[i] * x[i];
+        sum2 += a2[i] * x[i];
+        sum3 += a3[i] * x[i];
+    }
+    out[0] = sum0;
+    out[1] = sum1;
+    out[2] = sum2;
+    out[3] = sum3;
+}
+
+TARGET_SSE static void axpySse(float alpha, const float* x, float* y, int n) {
+    __m128 alpha_v = _mm_set1_ps(alpha);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(alpha_v, _mm_loadu_ps(x + i))));
+    }
+    for (; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+TARGET_SSE static void biasReluSse(const float* bias, float* y, int n) {
+    __m128 zero = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_max_ps(zero, _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(bias + i))));
+    }
+    for (; i < n; i++) {
+        y[i] = std::max(0.0f, y[i] + bias[i]);
+    }
+}
+
+TARGET_SSE static void momentumUpdateSse(float learning_rate, float momentum, const float* g, float* m, float* w, int n) {
+    __m128 learning_rate_v = _mm_set1_ps(learning_rate), momentum_v = _mm_set1_ps(momentum);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 mv = _mm_add_ps(_mm_mul_ps(momentum_v, _mm_loadu_ps(m + i)), _mm_loadu_ps(g + i));
+        _mm_storeu_ps(m + i, mv);
+        _mm_storeu_ps(w + i, _mm_sub_ps(_mm_loadu_ps(w + i), _mm_mul_ps(learning_rate_v, mv)));
+    }
+    momentumUpdateScalar(learning_rate, momentum, g + i, m + i, w + i, n - i);
+}
+
+TARGET_SSE static void rmspropUpdateSse(float learning_rate, float decay, float epsilon, const float* g, float* v, float* w, int n) {
+    __m128 learning_rate_v = _mm_set1_ps(learning_rate), epsilon_v = _mm_set1_ps(epsilon);
+    __m128 decay_v = _mm_set1_ps(decay), one_minus_decay_v = _mm_set1_ps(1.0f - decay);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 gv = _mm_loadu_ps(g + i);
+        __m128 vv = _mm_add_ps(_mm_mul_ps(decay_v, _mm_loadu_ps(v + i)), _mm_mul_ps(one_minus_decay_v, _mm_mul_ps(gv, gv)));
+        _mm_storeu_ps(v + i, vv);
+        __m128 step = _mm_div_ps(_mm_mul_ps(learning_rate_v, gv), _mm_add_ps(_mm_sqrt_ps(vv), epsilon_v));
+        _mm_storeu_ps(w + i, _mm_sub_ps(_mm_loadu_ps(w + i), step));
+    }
+    rmspropUpdateScalar(learning_rate, decay, epsilon, g + i, v + i, w + i, n - i);
+}
+
+TARGET_SSE static void adamUpdateSse(float step_size, float beta1, float beta2, float epsilon, const float* g, float* m, float* v, float* w, int n) {
+    __m128 step_size_v = _mm_set1_ps(step_size), epsilon_v = _mm_set1_ps(epsilon);
+    __m128 beta1_v = _mm_set1_ps(beta1), one_minus_beta1_v = _mm_set1_ps(1.0f - beta1);
+    __m128 beta2_v = _mm_set1_ps(beta2), one_minus_beta2_v = _mm_set1_ps(1.0f - beta2);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 gv = _mm_loadu_ps(g + i);
+        __m128 mv = _mm_add_ps(_mm_mul_ps(beta1_v, _mm_loadu_ps(m + i)), _mm_mul_ps(one_minus_beta1_v, gv));
+        __m128 vv = _mm_add_ps(_mm_mul_ps(beta2_v, _mm_loadu_ps(v + i)), _mm_mul_ps(one_minus_beta2_v, _mm_mul_ps(gv, gv)));
+        _mm_storeu_ps(m + i, mv);
+        _mm_storeu_ps(v + i, vv);
+        __m128 step = _mm_div_ps(_mm_mul_ps(step_size_v, mv), _mm_add_ps(_mm_sqrt_ps(vv), epsilon_v));
+        _mm_storeu_ps(w + i, _mm_sub_ps(_mm_loadu_ps(w + i), step));
+    }
+    adamUpdateScalar(step_size, beta1, beta2, epsilon, g + i, m + i, v + i, w + i, n - i);
+}
+
+TARGET_SSE static void lerpSse(float t, const float* x, float* y, int n) {
+    __m128 t_v = _mm_set1_ps(t), one_minus_t_v = _mm_set1_ps(1.0f - t);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(one_minus_t_v, _mm_loadu_ps(y + i)), _mm_mul_ps(t_v, _mm_loadu_ps(x + i))));
+    }
+    lerpScalar(t, x + i, y + i, n - i);
+}
+
+/*
+    AVX2 kernels, eight floats per register with fused multiply add.
+*/
+TARGET_AVX2 static inline float horizontalSum256(__m256 v) {
+    __m128 sums = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    __m128 shuffled = _mm_movehl_ps(sums, sums);
+    sums = _mm_add_ps(sums, shuffled);
+    shuffled = _mm_shuffle_ps(sums, sums, 0x55);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+TARGET_AVX2 static float dotAvx2(const float* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = horizontalSum256(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+TARGET_AVX2 static void dot4Avx2(const float* x, const float* a0, const float* a1, const float* a2, const float* a3, int n, float* out) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(), acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 xv = _mm256_loadu_ps(x + i);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a0 + i), xv, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a1 + i), xv, acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a2 + i), xv, acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a3 + i), xv, acc3);
+    }
+    float sum0 = horizontalSum256(acc0), sum1 = horizontalSum256(acc1);
+    float sum2 = horizontalSum256(acc2), sum3 = horizontalSum256(acc3);
+    for (; i < n; i++) {
+        sum0 += a0[i] * x[i];
+        sum1 += a1[i] * x[i];
+        sum2 += a2[i] * x[i];
+        sum3 += a3[i] * x[i];
+    }
+    out[0] = sum0;
+    out[1] = sum1;
+    out[2] = sum2;
+    out[3] = sum3;
+}
+
+TARGET_AVX2 static void axpyAvx2(float alpha, const float* x, float* y, int n) {
+    __m256 alpha_v = _mm256_set1_ps(alpha);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(alpha_v, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for (; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+TARGET_AVX2 static void biasReluAvx2(const float* bias, float* y, int n) {
+    __m256 zero = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_max_ps(zero, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(bias + i))));
+    }
+    for (; i < n; i++) {
+        y[i] = std::max(0.0f, y[i] + bias[i]);
+    }
+}
+
+TARGET_AVX2 static void momentumUpdateAvx2(float learning_rate, float momentum, const float* g, float* m, float* w, int n) {
+    __m256 learning_rate_v = _mm256_set1_ps(learning_rate), momentum_v = _mm256_set1_ps(momentum);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 mv = _mm256_fmadd_ps(momentum_v, _mm256_loadu_ps(m + i), _mm256_loadu_ps(g + i));
+        _mm256_storeu_ps(m + i, mv);
+        _mm256_storeu_ps(w + i, _mm256_fnmadd_ps(learning_rate_v, mv, _mm256_loadu_ps(w + i)));
+    }
+    momentumUpdateScalar(learning_rate, momentum, g + i, m + i, w + i, n - i);
+}
+
+TARGET_AVX2 static void rmspropUpdateAvx2(float learning_rate, float decay, float epsilon, const float* g, float* v, float* w, int n) {
+    __m256 learning_rate_v = _mm256_set1_ps(learning_rate), epsilon_v = _mm256_set1_ps(epsilon);
+    __m256 decay_v = _mm256_set1_ps(decay), one_minus_decay_v = _mm256_set1_ps(1.0f - decay);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 gv = _mm256_loadu_ps(g + i);
+        __m256 vv = _mm256_fmadd_ps(decay_v, _mm256_loadu_ps(v + i), _mm256_mul_ps(one_minus_decay_v, _mm256_mul_ps(gv, gv)));
+        _mm256_storeu_ps(v + i, vv);
+        __m256 step = _mm256_div_ps(_mm256_mul_ps(learning_rate_v, gv), _mm256_add_ps(_mm256_sqrt_ps(vv), epsilon_v));
+        _mm256_storeu_ps(w + i, _mm256_sub_ps(_mm256_loadu_ps(w + i), step));
+    }
+    rmspropUpdateScalar(learning_rate, decay, epsilon, g + i, v + i, w + i, n - i);
+}
+
+TARGET_AVX2 static void adamUpdateAvx2(float step_size, float beta1, float beta2, float epsilon, const float* g, float* m, float* v, float* w, int n) {
+    __m256 step_size_v = _mm256_set1_ps(step_size), epsilon_v = _mm256_set1_ps(epsilon);
+    __m256 beta1_v = _mm256_set1_ps(beta1), one_minus_beta1_v = _mm256_set1_ps(1.0f - beta1);
+    __m256 beta2_v = _mm256_set1_ps(beta2), one_minus_beta2_v = _mm256_set1_ps(1.0f - beta2);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 gv = _mm256_loadu_ps(g + i);
+        __m256 mv = _mm256_fmadd_ps(beta1_v, _mm256_loadu_ps(m + i), _mm256_mul_ps(one_minus_beta1_v, gv));
+        __m256 vv = _mm256_fmadd_ps(beta2_v, _mm256_loadu_ps(v + i), _mm256_mul_ps(one_minus_beta2_v, _mm256_mul_ps(gv, gv)));
+        _mm256_storeu_ps(m + i, mv);
+        _mm256_storeu_ps(v + i, vv);
+        __m256 step = _mm256_div_ps(_mm256_mul_ps(step_size_v, mv), _mm256_add_ps(_mm256_sqrt_ps(vv), epsilon_v));
+        _mm256_storeu_ps(w + i, _mm256_sub_ps(_mm256_loadu_ps(w + i), step));
+    }
+    adamUpdateScalar(step_size, beta1, beta2, epsilon, g + i, m + i, v + i, w + i, n - i);
+}
+
+TARGET_AVX2 static void lerpAvx2(float t, const float* x, float* y, int n) {
+    __m256 t_v = _mm256_set1_ps(t), one_minus_t_v = _mm256_set1_ps(1.0f - t);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(t_v, _mm256_loadu_ps(x + i), _mm256_mul_ps(one_minus_t_v, _mm256_loadu_ps(y + i))));
+    }
+    lerpScalar(t, x + i, y + i, n - i);
+}
+
+/*
+    AVX-512 kernels, sixteen floats per register with fused multiply add. The remainder of each
+    loop is handled with a masked load rather than a scalar loop.
+*/
+TARGET_AVX512 static inline __mmask16 tailMask(int remaining) {
+    return (__mmask16)((1u << remaining) - 1);
+}
+
+TARGET_AVX512 static float dotAvx512(const float* a, const float* b, int n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < n) {
+        __mmask16 mask = tailMask(n - i);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+TARGET_AVX512 static void dot4Avx512(const float* x, const float* a0, const float* a1, const float* a2, const float* a3, int n, float* out) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps(), acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 xv = _mm512_loadu_ps(x + i);
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a0 + i), xv, acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a1 + i), xv, acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(a2 + i), xv, acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(a3 + i), xv, acc3);
+    }
+    if (i < n) {
+        __mmask16 mask = tailMask(n - i);
+        __m512 xv = _mm512_maskz_loadu_ps(mask, x + i);
+        acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a0 + i), xv, acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a1 + i), xv, acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a2 + i), xv, acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a3 + i), xv, acc3);
+    }
+    out[0] = _mm512_reduce_add_ps(acc0);
+    out[1] = _mm512_reduce_add_ps(acc1);
+    out[2] = _mm512_reduce_add_ps(acc2);
+    out[3] = _mm512_reduce_add_ps(acc3);
+}
+
+TARGET_AVX512 static void axpyAvx512(float alpha, const float* x, float* y, int n) {
+    __m512 alpha_v = _mm512_set1_ps(alpha);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(alpha_v, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+    if (i < n) {
+        __mmask16 mask = tailMask(n - i);
+        __m512 result = _mm512_fmadd_ps(alpha_v, _mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i));
+        _mm512_mask_storeu_ps(y + i, mask, result);
+    }
+}
+
+TARGET_AVX512 static void biasReluAvx512(const float* bias, float* y, int n) {
+    __m512 zero = _mm512_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_max_ps(zero, _mm512_add_ps(_mm512_loadu_ps(y + i), _mm512_loadu_ps(bias + i))));
+    }
+    if (i < n) {
+        __mmask16 mask = tailMask(n - i);
+        __m512 result = _mm512_max_ps(zero, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, y + i), _mm512_maskz_loadu_ps(mask, bias + i)));
+        _mm512_mask_storeu_ps(y + i, mask, result);
+    }
+}
+
+TARGET_AVX512 static void momentumUpdateAvx512(float learning_rate, float momentum, const float* g, float* m, float* w, int n) {
+    __m512 learning_rate_v = _mm512_set1_ps(learning_rate), momentum_v = _mm512_set1_ps(momentum);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? (__mmask16)0xFFFF : tailMask(n - i);
+        __m512 mv = _mm512_fmadd_ps(momentum_v, _mm512_maskz_loadu_ps(mask, m + i), _mm512_maskz_loadu_ps(mask, g + i));
+        _mm512_mask_storeu_ps(m + i, mask, mv);
+        _mm512_mask_storeu_ps(w + i, mask, _mm512_fnmadd_ps(learning_rate_v, mv, _mm512_maskz_loadu_ps(mask, w + i)));
+    }
+}
+
+TARGET_AVX512 static void rmspropUpdateAvx512(float learning_rate, float decay, float epsilon, const float* g, float* v, float* w, int n) {
+    __m512 learning_rate_v = _mm512_set1_ps(learning_rate), epsilon_v = _mm512_set1_ps(epsilon);
+    __m512 decay_v = _mm512_set1_ps(decay), one_minus_decay_v = _mm512_set1_ps(1.0f - decay);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? (__mmask16)0xFFFF : tailMask(n - i);
+        __m512 gv = _mm512_maskz_loadu_ps(mask, g + i);
+        __m512 vv = _mm512_fmadd_ps(decay_v, _mm512_maskz_loadu_ps(mask, v + i), _mm512_mul_ps(one_minus_decay_v, _mm512_mul_ps(gv, gv)));
+        _mm512_mask_storeu_ps(v + i, mask, vv);
+        __m512 step = _mm512_div_ps(_mm512_mul_ps(learning_rate_v, gv), _mm512_add_ps(_mm512_sqrt_ps(vv), epsilon_v));
+        _mm512_mask_storeu_ps(w + i, mask, _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, w + i), step));
+    }
+}
+
+TARGET_AVX512 static void adamUpdateAvx512(float step_size, float beta1, float beta2, float epsilon, const float* g, float* m, float* v, float* w, int n) {
+    __m512 step_size_v = _mm512_set1_ps(step_size), epsilon_v = _mm512_set1_ps(epsilon);
+    __m512 beta1_v = _mm512_set1_ps(beta1), one_minus_beta1_v = _mm512_set1_ps(1.0f - beta1);
+    __m512 beta2_v = _mm512_set1_ps(beta2), one_minus_beta2_v = _mm512_set1_ps(1.0f - beta2);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? (__mmask16)0xFFFF : tailMask(n - i);
+        __m512 gv = _mm512_maskz_loadu_ps(mask, g + i);
+        __m512 mv = _mm512_fmadd_ps(beta1_v, _mm512_maskz_loadu_ps(mask, m + i), _mm512_mul_ps(one_minus_beta1_v, gv));
+        __m512 vv = _mm512_fmadd_ps(beta2_v, _mm512_maskz_loadu_ps(mask, v + i), _mm512_mul_ps(one_minus_beta2_v, _mm512_mul_ps(gv, gv)));
+        _mm512_mask_storeu_ps(m + i, mask, mv);
+        _mm512_mask_storeu_ps(v + i, mask, vv);
+        __m512 step = _mm512_div_ps(_mm512_mul_ps(step_size_v, mv), _mm512_add_ps(_mm512_sqrt_ps(vv), epsilon_v));
+        _mm512_mask_storeu_ps(w + i, mask, _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, w + i), step));
+    }
+}
+
+TARGET_AVX512 static void lerpAvx512(float t, const float* x, float* y, int n) {
+    __m512 t_v = _mm512_set1_ps(t), one_minus_t_v = _mm512_set1_ps(1.0f - t);
+    for (int i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? (__mmask16)0xFFFF : tailMask(n - i);
+        __m512 yv = _mm512_mul_ps(one_minus_t_v, _mm512_maskz_loadu_ps(mask, y + i));
+        _mm512_mask_storeu_ps(y + i, mask, _mm512_fmadd_ps(t_v, _mm512_maskz_loadu_ps(mask, x + i), yv));
+    }
+}
+
+#endif
+
+static const SimdKernels scalar_kernels = {SIMD_SCALAR, "scalar", dotScalar, dot4Scalar, axpyScalar, biasReluScalar,
+                                           momentumUpdateScalar, rmspropUpdateScalar, adamUpdateScalar, lerpScalar};
+#ifdef SIMD_X86
+static const SimdKernels sse_kernels = {SIMD_SSE, "sse", dotSse, dot4Sse, axpySse, biasReluSse,
+                                        momentumUpdateSse, rmspropUpdateSse, adamUpdateSse, lerpSse};
+static const SimdKernels avx2_kernels = {SIMD_AVX2, "avx2", dotAvx2, dot4Avx2, axpyAvx2, biasReluAvx2,
+                                         momentumUpdateAvx2, rmspropUpdateAvx2, adamUpdateAvx2, lerpAvx2};
+static const SimdKernels avx512_kernels = {SIMD_AVX512, "avx512", dotAvx512, dot4Avx512, axpyAvx512, biasReluAvx512,
+                                           momentumUpdateAvx512, rmspropUpdateAvx512, adamUpdateAvx512, lerpAvx512};
+#endif
+
+static std::atomic<const SimdKernels*> active_kernels(nullptr);
+
+/*
+    Function: detectSimdLevel
+
+    Description: Query the CPU (CPUID, and XGETBV for the operating system register support) for
+        the widest supported instruction set. AVX2 kernels also require FMA.
+
+    Arguments:
+        None
+
+    Returns:
+        (SimdLevel) The best instruction set the kernels can use on this machine.
+*/
+SimdLevel detectSimdLevel() {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE;
+#endif
+    return SIMD_SCALAR;
+}
+
+/*
+    Function: simdKernelsFor
+
+    Description: Get the kernel table of an instruction set.
+
+    Arguments:
+        (SimdLevel) level: The instruction set.
+
+    Returns:
+        (const SimdKernels*) The kernel table, or nullptr if this CPU does not support the
+            instruction set.
+*/
+const SimdKernels* simdKernelsFor(SimdLevel level) {
+    if (level > detectSimdLevel()) {
+        return nullptr;
+    }
+    switch (level) {
+#ifdef SIMD_X86
+        case SIMD_AVX512: return &avx512_kernels;
+        case SIMD_AVX2: return &avx2_kernels;
+        case SIMD_SSE: return &sse_kernels;
+#endif
+        default: return &scalar_kernels;
+    }
+}
+
+/*
+    Function: simdKernels
+
+    Description: Get the kernel table used by the matrix routines. On first use this is the
+        table of the best instruction set detected, unless setSimdLevel has been called.
+
+    Arguments:
+        None
+
+    Returns:
+        (const SimdKernels&) The active kernel table.
+*/
+const SimdKernels& simdKernels() {
+    const SimdKernels* kernels = active_kernels.load(std::memory_order_acquire);
+    if (kernels == nullptr) {
+        kernels = simdKernelsFor(detectSimdLevel());
+        active_kernels.store(kernels, std::memory_order_release);
+    }
+    return *kernels;
+}
+
+/*
+    Function: setSimdLevel
+
+    Description: Select the instruction set used by the matrix routines, for example to compare
+        kernels in a benchmark or to rule out the vector kernels when debugging. A level the CPU
+        does not support falls back to the best supported level.
+
+    Arguments:
+        (SimdLevel) level: The instruction set to use.
+
+    Returns:
+        None
+*/
+void setSimdLevel(SimdLevel level) {
+    const SimdKernels* kernels = simdKernelsFor(std::min(level, detectSimdLevel()));
+    active_kernels.store(kernels, std::memory_order_release);
+}
@@ -0,0 +1,110 @@
+#include "../include/sum_tree.h"
+
+/*
+    Class: SumTree
+
+    Component: Constructor
+
+    Name: SumTree
+
+    Description: Create a sum tree with every priority set to zero. The number of leaves is
+        rounded up to a power of two so that the tree is complete.
+
+    Arguments:
+        (size_t) capacity: The number of priorities the tree holds.
+
+    Returns:
+        None
+*/
+SumTree::SumTree(size_t capacity) : leaf_count(1) {
+    while (leaf_count < capacity) {
+        leaf_count *= 2;
+    }
+    nodes.assign(2 * leaf_count, 0.0);
+}
+
+/*
+    Class: SumTree
+
+    Component: Method
+
+    Name: update
+
+    Description: Set the priority of one leaf and update the sums on the path to the root, in
+        O(log n).
+
+    Arguments:
+        (size_t) index: The leaf index.
+        (double) priority: The new priority, zero or positive.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    for (node /= 2; node >= 1; node /= 2) {
+        nodes[node] += change;
+    }
+
+    Explanation:
+
+    Walk up from the leaf to the root, adding the change in priority to every parent.
+*/
+void SumTree::update(size_t index, double priority) {
+    size_t node = leaf_count + index;
+    double change = priority - nodes[node];
+    nodes[node] = priority;
+    for (node /= 2; node >= 1; node /= 2) {
+        nodes[node] += change;
+    }
+}
+
+/*
+    Class: SumTree
+
+    Component: Method
+
+    Name: find
+
+    Description: Find the leaf where the running sum of priorities passes a value, in O(log n).
+        Drawing value uniformly from [0, total()) selects each leaf with probability proportional
+        to its priority.
+
+    Arguments:
+        (double) value: A value in [0, total()).
+
+    Returns:
+        (size_t) The leaf index.
+
+    Code Explanation:
+
+    Code:
+
+    if (value < nodes[left] || nodes[left + 1] == 0) {
+        node = left;
+    } else {
+        value -= nodes[left];
+        node = left + 1;
+    }
+
+    Explanation:
+
+    Descend from the root. If the value falls within the sum of the left subtree go left,
+    otherwise subtract the left sum and go right. A right subtree with no priority is never
+    entered, which guards against rounding pushing the value just past the total.
+*/
+size_t SumTree::find(double value) const {
+    size_t node = 1;
+    while (node < leaf_count) {
+        size_t left = 2 * node;
+        if (value < nodes[left] || nodes[left + 1] == 0) {
+            node = left;
+        } else {
+            value -= nodes[left];
+            node = left + 1;
+        }
+    }
+    return node - leaf_count;
+}
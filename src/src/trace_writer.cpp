@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include "../include/trace_writer.h"
+
+// How long the writer thread sleeps when the ring is empty.
+const std::chrono::milliseconds TRACE_WRITER_POLL(2);
+
+/*
+    Class: TraceWriter
+
+    Component: Constructor
+
+    Name: TraceWriter
+
+    Description: Create the trace file and start the writer thread. With an interval of zero
+        nothing is created or started and record is never expected to be called.
+
+    Arguments:
+        (std::string) filepath: The trace file, replaced if it exists.
+        (size_t) capacity: The minimum number of records the ring holds, rounded up to a power of
+            two. Only needs to cover the steps recorded while the writer sleeps or writes.
+        (int) interval: Record every interval-th step, 0 to turn tracing off.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    Explanation:
+
+    The header goes out first with zero counts, so a trace cut short by a crash can still be read
+    up to its last whole record. close rewrites it with the final counts.
+*/
+TraceWriter::TraceWriter(const std::string& filepath, size_t capacity, int interval)
+    : capacity(1)
+    , interval(interval)
+    , dropped(0)
+    , written(0)
+    , head(0)
+    , tail(0)
+    , stop(false)
+{
+    if (interval <= 0) {
+        TraceWriter::interval = 0;
+        return;
+    }
+    if (capacity == 0) {
+        throw std::runtime_error("Trace buffer capacity must be greater than zero");
+    }
+    while (TraceWriter::capacity < capacity) {
+        TraceWriter::capacity <<= 1;
+    }
+    mask = TraceWriter::capacity - 1;
+    records.reset(new TraceRecord[TraceWriter::capacity]);
+
+    file.open(filepath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Could not open trace file for writing: " + filepath);
+    }
+    TraceHeader header = {};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.action_size = ACTION_SIZE;
+    header.interval = interval;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    writer = std::thread(&TraceWriter::writerLoop, this);
+}
+
+/*
+    Class: TraceWriter
+
+    Component: Destructor
+
+    Name: ~TraceWriter
+
+    Description: Write out whatever is left in the ring and close the file.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+/*
+    Class: TraceWriter
+
+    Component: Method
+
+    Name: record
+
+    Description: Queue a record for writing. Only the training thread may call this.
+
+    Arguments:
+        (TraceRecord) record: The record, copied into the ring.
+
+    Returns:
+        (bool) False if the ring was full and the record was dropped.
+
+    Code Explanation:
+
+    Code:
+
+    if (position - tail.load(std::memory_order_acquire) == capacity) {
+
+    Explanation:
+
+    A full ring means the writer is a whole ring behind. Waiting for it would put the disk back
+    on the training step, so the record is dropped and counted instead.
+*/
+bool TraceWriter::record(const TraceRecord& record) {
+    size_t position = head.load(std::memory_order_relaxed);
+    if (position - tail.load(std::memory_order_acquire) == capacity) {
+        dropped++;
+        return false;
+    }
+    records[position & mask] = record;
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+/*
+    Class: TraceWriter
+
+    Component: Method
+
+    Name: close
+
+    Description: Stop the writer thread once the ring is empty, fill in the header's counts and
+        close the file. Safe to call more than once.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+void TraceWriter::close() {
+    if (!writer.joinable()) {
+        return;
+    }
+    stop.store(true, std::memory_order_release);
+    writer.join();
+
+    TraceHeader header = {};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.action_size = ACTION_SIZE;
+    header.interval = interval;
+    header.record_count = written;
+    header.dropped_count = dropped;
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+}
+
+/*
+    Class: TraceWriter
+
+    Component: Method
+
+    Name: writerLoop
+
+    Description: The writer thread. Writes out the ring whenever it holds records and sleeps
+        while it is empty, until close is called and the ring is empty.
+
+    Arguments:
+        None
+
+    Returns:
+        None
+*/
+void TraceWriter::writerLoop() {
+    while (true) {
+        bool stopping = stop.load(std::memory_order_acquire);
+        if (flush() == 0) {
+            if (stopping) return;
+            std::this_thread::sleep_for(TRACE_WRITER_POLL);
+        }
+    }
+}
+
+/*
+    Class: TraceWriter
+
+    Component: Method
+
+    Name: flush
+
+    Description: Write every record in the ring to the file and free their slots. Only the writer
+        thread may call this.
+
+    Arguments:
+        None
+
+    Returns:
+        (size_t) The number of records written.
+
+    Code Explanation:
+
+    Code:
+
+    size_t first = std::min(end - start, capacity - (start & mask));
+
+    Explanation:
+
+    The records are written straight from the ring, in at most two blocks when they wrap round
+    its end, then their slots are handed back to the training thread in one store.
+*/
+size_t TraceWriter::flush() {
+    size_t start = tail.load(std::memory_order_relaxed);
+    size_t end = head.load(std::memory_order_acquire);
+    if (start == end) {
+        return 0;
+    }
+
+    size_t first = std::min(end - start, capacity - (start & mask));
+    file.write(reinterpret_cast<const char*>(&records[start & mask]), first * sizeof(TraceRecord));
+    file.write(reinterpret_cast<const char*>(&records[0]), (end - start - first) * sizeof(TraceRecord));
+
+    tail.store(end, std::memory_order_release);
+    written += end - start;
+    return end - start;
+}
+
+/*
+    Function: readTrace
+
+    Description: Read a trace file written by TraceWriter. A trace whose run did not finish has
+        a record count of zero in its header, every whole record in the file is read instead.
+
+    Arguments:
+        (std::string) filepath: The trace file.
+        (TraceHeader) header: Set to the file's header.
+
+    Returns:
+        (std::vector<TraceRecord>) The records in step order.
+*/
+std::vector<TraceRecord> readTrace(const std::string& filepath, TraceHeader& header) {
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Could not open trace file: " + filepath);
+    }
+    size_t file_size = file.tellg();
+    file.seekg(0);
+
+    if (file_size < sizeof(TraceHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        throw std::runtime_error("Invalid trace " + filepath + ": file too small for the header");
+    }
+    if (std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        throw std::runtime_error("Invalid trace " + filepath + ": not a trace file");
+    }
+    if (header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord) || header.action_size != ACTION_SIZE) {
+        throw std::runtime_error("Invalid trace " + filepath + ": written by an incompatible version");
+    }
+
+    size_t count = (file_size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    if (header.record_count != 0 && header.record_count < count) {
+        count = header.record_count;
+    }
+    std::vector<TraceRecord> records(count);
+    file.read(reinterpret_cast<char*>(records.data()), count * sizeof(TraceRecord));
+    return records;
+}
@@ -0,0 +1,121 @@
+#include <stdexcept>
+
+#include "../include/transition_queue.h"
+
+/*
+    Class: TransitionQueue
+
+    Component: Constructor
+
+    Name: TransitionQueue
+
+    Description: Create an empty queue. The capacity is rounded up to a power of two so that a
+        position maps to its slot with a mask.
+
+    Arguments:
+        (size_t) capacity: The minimum number of transitions the queue can hold.
+
+    Returns:
+        None
+
+    Code Explanation:
+
+    Code:
+
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+
+    Explanation:
+
+    Slot i is free for the producer claiming position i. After the consumer frees it, it is free
+    for position i + capacity, one lap later, and so on.
+*/
+TransitionQueue::TransitionQueue(size_t capacity)
+    : capacity(1)
+    , tail(0)
+    , head(0)
+{
+    if (capacity == 0) {
+        throw std::runtime_error("Transition queue capacity must be greater than zero");
+    }
+    while (TransitionQueue::capacity < capacity) {
+        TransitionQueue::capacity <<= 1;
+    }
+    mask = TransitionQueue::capacity - 1;
+
+    slots.reset(new Slot[TransitionQueue::capacity]);
+    for (size_t i = 0; i < TransitionQueue::capacity; i++) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+/*
+    Class: TransitionQueue
+
+    Component: Method
+
+    Name: tryPush
+
+    Description: Add a transition to the queue without waiting. Safe to call from any number of
+        threads at once.
+
+    Arguments:
+        (Transition) transition: The transition to add.
+
+    Returns:
+        (bool) False if the queue is full, the transition is not added.
+
+    Code Explanation:
+
+    Code:
+
+    intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+    Explanation:
+
+    Zero means the slot is free for this position, try to claim the position by moving tail on
+    by one. If another producer got there first, the compare and swap reloads position and the
+    loop tries again. A negative difference means the slot still holds the transition from the
+    previous lap which the consumer has not drained, so the queue is full. A positive difference
+    means another producer has already claimed this position, so reload tail.
+*/
+bool TransitionQueue::tryPush(const Transition& transition) {
+    size_t position = tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[position & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if (difference == 0) {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->transition = transition;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+/*
+    Class: TransitionQueue
+
+    Component: Method
+
+    Name: size
+
+    Description: The number of claimed positions not yet drained. Only the consumer thread may
+        call this. Only exact when no producer is pushing, otherwise a snapshot which may include
+        transitions still being written.
+
+    Arguments:
+        None
+
+    Returns:
+        (size_t) The approximate number of queued transitions.
+*/
+size_t TransitionQueue::size() const {
+    return tail.load(std::memory_order_relaxed) - head;
+}
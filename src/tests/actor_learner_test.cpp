@@ -0,0 +1,47 @@
+#include <cmath>
+#include <iostream>
+
+#include "../include/actor_learner.h"
+#include "../include/logger.h"
+
+/*
+    Test: actor_learner_test
+
+    Description: Checks that the actor/learner pipeline trains at REPLAY_RATIO: after the replay
+        memory reaches the sampling threshold, the learner must take REPLAY_RATIO training steps
+        per transition it receives, however fast the actors are. Runs a short headless budget
+        with two actors at several ratios and returns 1 if any run is off by more than a couple
+        of steps.
+*/
+
+int main() {
+    logger().level = LOG_LEVEL_WARN;
+    const float ratios[] = {1.0f, 0.25f, 2.0f};
+
+    bool passed = true;
+    for (float ratio : ratios) {
+        GameParams game_params;
+        game_params.random_seed = 42;
+        NetworkParams params;
+        params.RANDOM_SEED = 42;
+        params.NUM_ACTORS = 2;
+        params.NUM_ENVIRONMENTS = 4;
+        params.SAMPLING_THRESHOLD = 1000;
+        params.HEADLESS_MAX_STEPS = 3000;
+        params.HEADLESS_MAX_EPISODES = 0;
+        params.REPLAY_RATIO = ratio;
+
+        DQN dqn(STATE_SIZE, ACTION_SIZE, params.MEMORY_CAPACITY, params);
+        ActorLearner actor_learner(dqn, game_params, params);
+        actor_learner.run();
+
+        double expected = (actor_learner.steps - params.SAMPLING_THRESHOLD) * ratio;
+        bool ok = std::abs(actor_learner.train_steps - expected) <= ratio + 1;
+        std::cout << "REPLAY_RATIO " << ratio << ": " << actor_learner.steps << " transitions, " << actor_learner.train_steps
+                  << " training steps, expected " << expected << (ok ? "" : " FAILED") << std::endl;
+        passed = passed && ok;
+    }
+
+    std::cout << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
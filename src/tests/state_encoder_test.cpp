@@ -0,0 +1,107 @@
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../include/dqn.h"
+#include "../include/environment.h"
+#include "../include/game.h"
+#include "../include/game_params.h"
+#include "../include/rng.h"
+
+/*
+    Test: state_encoder_test
+
+    Description: Checks that StateEncoder::encode writes exactly the same bits as the reference
+        getState, on the default board and on larger ones. Each board is played two ways with
+        random actions. The first plays normal games, with collision checks, food and growth.
+        The second leaves collisions unchecked and grows the snake at random, so its body
+        overlaps itself and its head wanders off the board, which covers the encoder's fallback
+        paths. Prints the number of differing states per board and returns 1 if there were any.
+*/
+
+// Compares the two encodings of the current game state, printing the first few differences.
+bool sameState(const StateEncoder& encoder, const Game& game, int cell_count, long& mismatches) {
+    std::vector<float> expected = getState(game.snake, game.food);
+    float encoded[STATE_SIZE];
+    encoder.encode(game.snake, game.food, encoded);
+    if (std::memcmp(expected.data(), encoded, sizeof(encoded)) == 0) {
+        return true;
+    }
+
+    if (mismatches++ < 5) {
+        Cell head = game.snake.head();
+        std::cout << "cell_count " << cell_count << ", head (" << head.x << ", " << head.y << "), length " << game.snake.body.size() << ":";
+        for (int i = 0; i < STATE_SIZE; i++) {
+            if (std::memcmp(&expected[i], &encoded[i], sizeof(float)) != 0) {
+                std::cout << " feature " << i << " getState " << expected[i] << " encode " << encoded[i];
+            }
+        }
+        std::cout << std::endl;
+    }
+    return false;
+}
+
+// Normal games: random actions with collision checks, so the snake eats, grows and dies.
+long playGames(int cell_count, int steps, Rng& rng) {
+    GameParams params;
+    params.cell_count = cell_count;
+    params.random_seed = cell_count;
+    Game game(false, 0, params, 0);
+    StateEncoder encoder(params);
+
+    long mismatches = 0;
+    for (int step = 0; step < steps; step++) {
+        applyAction(game, rng.below(ACTION_SIZE));
+        game.snake.update();
+        game.checkCollisions();
+        game.game_running = true;
+        sameState(encoder, game, cell_count, mismatches);
+    }
+    return mismatches;
+}
+
+// Unchecked games: nothing ends the game, the snake grows on a quarter of its moves and is
+// only reset every few board widths, so it runs into itself and off the board.
+long playUnchecked(int cell_count, int steps, Rng& rng) {
+    GameParams params;
+    params.cell_count = cell_count;
+    params.random_seed = cell_count;
+    Game game(false, 0, params, 0);
+    StateEncoder encoder(params);
+
+    long mismatches = 0;
+    bool overlapped = false, left_board = false;
+    for (int step = 0; step < steps; step++) {
+        if (step % (4 * cell_count) == 0) {
+            game.snake.reset();
+        }
+        applyAction(game, rng.below(ACTION_SIZE));
+        game.snake.add_segment = rng.below(4) == 0;
+        game.snake.update();
+        overlapped = overlapped || game.snake.overlapping;
+        left_board = left_board || !game.snake.occupancy.inside(game.snake.head().x, game.snake.head().y);
+        sameState(encoder, game, cell_count, mismatches);
+    }
+
+    if (!overlapped || !left_board) {
+        std::cout << "cell_count " << cell_count << ": the unchecked snake never " << (overlapped ? "left the board" : "overlapped itself") << std::endl;
+        mismatches++;
+    }
+    return mismatches;
+}
+
+int main() {
+    const int steps = 200000;
+    const int cell_counts[] = {8, 10, 16, 25, MAX_CELL_COUNT};
+    Rng rng(42);
+
+    long total = 0;
+    for (int cell_count : cell_counts) {
+        long mismatches = playGames(cell_count, steps, rng) + playUnchecked(cell_count, steps, rng);
+        std::cout << "cell_count " << cell_count << ": " << mismatches << " of " << 2 * steps << " states differ" << std::endl;
+        total += mismatches;
+    }
+
+    std::cout << (total == 0 ? "passed" : "FAILED") << std::endl;
+    return total == 0 ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/trace_writer.h"
+
+/*
+    Tool: trace_decoder
+
+    Description: Decodes a binary training trace written by TraceWriter to standard output, as
+        CSV with one row per record, or as text in the layout of the old q_values.txt log.
+
+    Usage:
+        trace_decoder <trace file> [csv|text]
+*/
+
+void printCsv(const std::vector<TraceRecord>& records) {
+    std::cout << "step,action,reward,done,head_x,head_y,food_x,food_y";
+    for (int i = 0; i < ACTION_SIZE; i++) std::cout << ",q" << i;
+    for (int i = 0; i < ACTION_SIZE; i++) std::cout << ",q" << i << "_after";
+    std::cout << "\n";
+
+    for (const TraceRecord& record : records) {
+        std::cout << record.step << "," << record.action << "," << record.reward << "," << (int)record.done << ","
+                  << record.head_x << "," << record.head_y << "," << record.food_x << "," << record.food_y;
+        for (int i = 0; i < ACTION_SIZE; i++) std::cout << "," << record.q_values[i];
+        for (int i = 0; i < ACTION_SIZE; i++) std::cout << "," << record.q_values_after[i];
+        std::cout << "\n";
+    }
+}
+
+void printText(const std::vector<TraceRecord>& records) {
+    for (const TraceRecord& record : records) {
+        std::cout << "-----------\n";
+        std::cout << "step " << record.step << "\n";
+        std::cout << "snake head x " << record.head_x << "\n";
+        std::cout << "snake head y " << record.head_y << "\n";
+        std::cout << "food position x " << record.food_x << "\n";
+        std::cout << "food position y " << record.food_y << "\n";
+        std::cout << "action " << record.action << "\n";
+        std::cout << "reward " << record.reward << "\n";
+        std::cout << "done " << (int)record.done << "\n";
+        std::cout << "Q values original\n";
+        for (int i = 0; i < ACTION_SIZE; i++) std::cout << record.q_values[i] << "\n";
+        std::cout << "Q values after training >> should be updated\n";
+        for (int i = 0; i < ACTION_SIZE; i++) std::cout << record.q_values_after[i] << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string format = argc > 2 ? argv[2] : "csv";
+    if (argc < 2 || (format != "csv" && format != "text")) {
+        std::cerr << "usage: trace_decoder <trace file> [csv|text]" << std::endl;
+        return 1;
+    }
+
+    try {
+        TraceHeader header;
+        std::vector<TraceRecord> records = readTrace(argv[1], header);
+        if (format == "csv") {
+            printCsv(records);
+        } else {
+            printText(records);
+        }
+        std::cerr << records.size() << " records ::: interval: " << header.interval << " ::: dropped: " << header.dropped_count
+                  << (header.record_count == 0 ? " ::: trace not closed, read up to the last whole record" : "") << std::endl;
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}